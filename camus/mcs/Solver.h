@@ -32,14 +32,6 @@ OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWA
 // Solver -- the main class:
 
 
-struct SolverStats {
-    int64   starts, decisions, propagations, inspects, conflicts;
-    int64   clauses, clauses_literals, learnts, learnts_literals;
-    SolverStats(void) : starts(0), decisions(0), propagations(0), inspects(0), conflicts(0)
-        , clauses(0), clauses_literals(0), learnts(0), learnts_literals(0) { }
-};
-
-
 struct SearchParams {
     double  var_decay, clause_decay, random_var_freq;    // (reasonable values are: 0.95, 0.999, 0.02)    
     SearchParams(double v = 1, double c = 1, double r = 0) : var_decay(v), clause_decay(c), random_var_freq(r) { }
@@ -61,6 +53,7 @@ public:
     double              var_inc;        // Amount to bump next variable with.
     double              var_decay;      // INVERSE decay factor for variable activity: stores 1/decay. Use negative value for static variable order.
     VarOrder            order;          // Keeps track of the decision variable order.
+    vec<char>           polarity;       // 'polarity[var]' is the value tried first when deciding 'var' (TRUE unless changed).
 
     vec<vec<Constr*> >  watches;        // 'watches[lit]' is a list of constraints watching 'lit' (will go there if literal becomes true).
     vec<vec<Constr*> >  undos;          // 'undos[var]' is a list of constraints that will be called when 'var' becomes unbound.
@@ -73,6 +66,7 @@ public:
     vec<Constr*>        reason;         // 'reason[var]' is the clause that implied the variables current value, or 'NULL' if none.
     vec<int>            level;          // 'level[var]' is the decision level at which assignment was made.
     int                 root_level;     // Level of first proper decision.
+    vec<Lit>            assumed;        // The assumptions of the last 'solve()' still on the trail, one per level.
     int                 last_simplify;  // Number of top-level assignments at last 'simplifyDB()'.
 
 	std::vector<Deriv*> derivs;         // Holds pointers to Deriv objects
@@ -97,6 +91,15 @@ public:
     void        analyzeFinalDeriv      (Constr* confl);
     void        analyzeFinalDerivLits  (const vec<Lit>& lits);
 
+    Constr*     root_confl;     // The conflict that made search() return l_False (at root_level)
+    void        analyzeFinal (const vec<Lit>& false_lits);
+
+    // The last 'solve()''s conflict, still on the trail until 'getConflict()' analyzes it
+    bool        final_pending;
+    Constr*     final_confl;    // The conflicting constraint, or NULL if ...
+    Lit         final_lit;      // ... the assumption 'final_lit' was already FALSE
+    int         final_level;    // The level it was found at (0 if none on the trail)
+
 	// MHL - 7-23-04
 	// copied out of enqueue, for use in AtMost::propagate, to make it not have
 	// 44 million function calls to this...
@@ -141,6 +144,11 @@ public:
                  , order            (assigns, activity)
                  , last_simplify    (-1)
 				 , finalDeriv(new Deriv())
+				 , root_confl(NULL)
+				 , final_pending(false)
+				 , final_confl(NULL)
+				 , final_lit(lit_Undef)
+				 , final_level(0)
 				 , decisionLevel(0)
 				 , nVars(0)
                  , progress_estimate(0)
@@ -180,6 +188,7 @@ public:
 	//void	addUnit(Lit p) { if (ok) enqueue(p); }
 	// MHL - 7-23-04
 	bool	addUnit(Lit p, const unsigned id=0) {
+		backToRoot();
 		bool ret = ok;
 //std::cout << "addUnit: " << (sign(p)?"~":"") << "x" << var(p) << std::endl;
 		if (ok) {
@@ -207,6 +216,7 @@ public:
     friend bool AtMost_new(Solver& S, const vec<Lit>& ps, int  max   , AtMost*& out_constr, unsigned id, const bool doDeriv);
 
 	inline bool	addClause(const vec<Lit>& ps, const unsigned id=0) {
+		backToRoot();
 		bool tmpOK = true;
 		Clause* c = NULL;
 		if (ok) {
@@ -219,7 +229,32 @@ public:
 		}
 		return tmpOK;
 	}
+	// MHL - a clause standing in for several original clauses (e.g. with some
+	// of their selector literals removed), so it has several ancestors
+	inline bool	addClause(const vec<Lit>& ps, const Bag& ids) {
+		backToRoot();
+		bool tmpOK = true;
+		Clause* c = NULL;
+		Deriv* deriv = NULL;
+		if (doDeriv) {
+			deriv = new Deriv();
+			derivs.push_back(deriv);
+			for (Bag::const_iterator it = ids.begin() ; it != ids.end() ; it++) {
+				deriv->addAncestor(*it);
+			}
+		}
+		if (ok) {
+			tmpOK = Clause_new(*this, ps, false, c, 0, doDeriv, deriv);
+			if (c != NULL) constrs.push(c);
+		}
+		if (!tmpOK && doDeriv) {
+			analyzeFinalDerivLits(ps);
+			finalDeriv->addDeriv(deriv);
+		}
+		return tmpOK;
+	}
 	inline bool	addAtMost(const vec<Lit>& ps, const int n, const unsigned id=0) {
+		backToRoot();
 		if (ok) {
 			AtMost* c = NULL;
 			ok = AtMost_new(*this, ps, n, c, id, doDeriv);
@@ -228,13 +263,19 @@ public:
 		return ok;
 	}
 
+    // Drop any assumptions left from 'solve()' (analyzing its conflict first, while it is
+    // still on the trail, in case 'getConflict()' is called after adding a constraint)
+    void    backToRoot(void) { if (final_pending) getConflict(); cancelUntil(0); final_level = 0; }
+
     // Solving:
     //
     bool    okay(void) { return ok; }
     void    simplifyDB(void);
-	bool	solve();
-    //bool    solve(const vec<Lit>& assumps);
-    //bool    solve(void) { vec<Lit> tmp; return solve(tmp); }
+    bool    solve(const vec<Lit>& assumps);
+    bool    solve(void) { vec<Lit> tmp; return solve(tmp); }
+
+    const vec<Lit>& getConflict(void);
+    vec<Lit>    conflict;           // (see 'getConflict()')
 
     double      progress_estimate;  // Set by 'search()'.
     //vec<lbool>  model;              // If problem is solved, this vector contains the model (if any).
@@ -58,4 +58,15 @@ const Lit lit_Error(var_Undef, true );  // }
 
 
 //=================================================================================================
+// Statistics:
+
+// MHL - here rather than in Solver.h, so any SAT backend (see satbackend.h) can report them
+struct SolverStats {
+    int64   starts, decisions, propagations, inspects, conflicts;
+    int64   clauses, clauses_literals, learnts, learnts_literals;
+    SolverStats(void) : starts(0), decisions(0), propagations(0), inspects(0), conflicts(0)
+        , clauses(0), clauses_literals(0), learnts(0), learnts_literals(0) { }
+};
+
+
 #endif
@@ -26,16 +26,20 @@ OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWA
 //=================================================================================================
 
 
+// MHL - variables in a higher tier are always decided first (activity only
+// orders variables within a tier)
 struct VarOrder_lt {
     const vec<double>&  activity;
-    bool operator () (Var x, Var y) { return activity[x] > activity[y]; }
-    VarOrder_lt(const vec<double>&  act) : activity(act) { }
+    const vec<char>&    tier;
+    bool operator () (Var x, Var y) { return tier[x] != tier[y] ? tier[x] > tier[y] : activity[x] > activity[y]; }
+    VarOrder_lt(const vec<double>&  act, const vec<char>& t) : activity(act), tier(t) { }
 };
 
 class VarOrder {
     //const vec<char>&    assigns;     // var->val. Pointer to external assignment table.
     const vec<lbool>&    assigns;     // var->val. Pointer to external assignment table.
     const vec<double>&  activity;    // var->act. Pointer to external activity table.
+    vec<char>           tier;        // var->decision tier (0 unless raised by prioritize())
     Heap<VarOrder_lt>   heap;
     double              random_seed; // For the internal random number generator
 	int                 nVars;
@@ -43,10 +47,11 @@ class VarOrder {
 public:
     //VarOrder(const vec<char>& ass, const vec<double>& act) :
     VarOrder(const vec<lbool>& ass, const vec<double>& act) :
-        assigns(ass), activity(act), heap(VarOrder_lt(act)), random_seed(91648253), nVars(0)
+        assigns(ass), activity(act), heap(VarOrder_lt(act, tier)), random_seed(91648253), nVars(0)
         { }
 
     inline void newVar(void);
+    inline void prioritize(Var x);              // Moves a variable up to the first tier.
     inline void update(Var x);                  // Called when variable increased in activity.
     inline void undo(Var x);                    // Called when variable is unassigned and may be selected again.
     inline Var  select(double random_freq =.0); // Selects a new, unassigned variable (or 'var_Undef' if none exists).
@@ -58,11 +63,20 @@ void VarOrder::newVar(void)
     //heap.setBounds(assigns.size());
     //heap.insert(assigns.size()-1);
 	nVars++;
+	tier.push(0);
 	heap.setBounds(nVars);
 	heap.insert(nVars-1);
 }
 
 
+void VarOrder::prioritize(Var x)
+{
+    tier[x] = 1;
+    if (heap.inHeap(x))
+        heap.increase(x);
+}
+
+
 void VarOrder::update(Var x)
 {
     if (heap.inHeap(x))
@@ -0,0 +1,88 @@
+//
+//  autarky.cpp  -  Finding the largest autarky of a CNF formula.
+//
+// Copyright (C) 2009, The Regents of the University of Michigan
+// See the LICENSE file for details.
+//
+
+#include "autarky.h"
+#include "satbackend.h"
+
+// The encoding's literal for "l is assigned TRUE by the autarky"
+static inline Lit assignedTrue(Lit l) {
+	return Lit(2*var(l) + sign(l));
+}
+
+unsigned int findMaxAutarky(unsigned int numVars, const vector< vector<Lit> >& clauses, vector<bool>& inAutarky) {
+	inAutarky.assign(clauses.size(), false);
+
+	ScopedSAT scoped;
+	SATBackend& sat = *scoped;
+	// 2v: v assigned TRUE, 2v+1: v assigned FALSE, then one activation
+	// variable per clause (TRUE while the clause is still in the formula)
+	while ((unsigned int)sat.nVars() < 2*numVars + clauses.size())  sat.newVar();
+	Var firstActive = 2*numVars;
+
+	for (unsigned int v = 0 ; v < numVars ; v++) {
+		vec<Lit> lits;
+		lits.push(~Lit(2*v));
+		lits.push(~Lit(2*v+1));
+		sat.addClause(lits);
+	}
+
+	// If a clause is active and any of its variables is assigned, one of its
+	// literals must be assigned TRUE
+	for (unsigned int i = 0 ; i < clauses.size() ; i++) {
+		const vector<Lit>& c = clauses[i];
+		for (unsigned int j = 0 ; j < c.size() ; j++) {
+			for (int val = 0 ; val < 2 ; val++) {
+				// val = 0: var(c[j]) assigned TRUE, val = 1: assigned FALSE
+				if (assignedTrue(c[j]) == Lit(2*var(c[j]) + val))  continue;  // satisfies c itself
+
+				vec<Lit> lits;
+				lits.push(~Lit(firstActive + i));
+				lits.push(~Lit(2*var(c[j]) + val));
+				for (unsigned int k = 0 ; k < c.size() ; k++) {
+					lits.push(assignedTrue(c[k]));
+				}
+				sat.addClause(lits);
+			}
+		}
+	}
+
+	unsigned int found = 0;
+	while (sat.okay()) {
+		// at least one remaining clause must be satisfied (i.e., a non-empty
+		// autarky), through a clause retired after this call
+		Lit a = Lit(sat.newVar());
+		vec<Lit> D;
+		vec<Lit> assumps;
+		D.push(~a);
+		for (unsigned int i = 0 ; i < clauses.size() ; i++) {
+			if (inAutarky[i])  continue;
+			for (unsigned int k = 0 ; k < clauses[i].size() ; k++) {
+				D.push(assignedTrue(clauses[i][k]));
+			}
+			assumps.push(Lit(firstActive + i));
+		}
+		assumps.push(a);
+		sat.addClause(D);
+
+		bool more = sat.solve(assumps);
+		sat.addUnit(~a);
+		if (!more)  break;
+
+		for (unsigned int i = 0 ; i < clauses.size() ; i++) {
+			if (inAutarky[i])  continue;
+			for (unsigned int k = 0 ; k < clauses[i].size() ; k++) {
+				if (sat.model()[var(assignedTrue(clauses[i][k]))] == true) {
+					inAutarky[i] = true;
+					found++;
+					break;
+				}
+			}
+		}
+	}
+
+	return found;
+}
@@ -0,0 +1,34 @@
+//
+//  autarky.h  -  Finding the largest autarky of a CNF formula.
+//
+// Copyright (C) 2009, The Regents of the University of Michigan
+// See the LICENSE file for details.
+//
+#ifndef __AUTARKY_H
+#define __AUTARKY_H
+
+#include "SolverTypes.h"
+#include <vector>
+
+using std::vector;
+
+// An autarky is a partial assignment that satisfies every clause in which it
+// assigns any variable.  The clauses it satisfies can be removed without
+// changing the satisfiability of any subset of the rest, so they are in no
+// MUS (and therefore in no MCS); what is left after removing the largest
+// autarky is the lean kernel.
+//
+// Autarkies are found with the encoding of Liffiton and Sakallah ("Searching
+// for Autarkies to Trim Unsatisfiable Clause Sets", SAT 2008): each variable
+// v gets two SAT variables, "v assigned TRUE" and "v assigned FALSE" (not
+// both), and each clause, while it is still in the formula, must be satisfied
+// if any of its variables is assigned.  Any model that satisfies at least one
+// clause gives a non-empty autarky.  Since the union of two autarkies is again
+// an autarky, removing the clauses found and repeating until there is no
+// model reaches the largest one.
+//
+// Sets inAutarky[i] for each clause i satisfied by the largest autarky and
+// returns the number of such clauses.
+unsigned int findMaxAutarky(unsigned int numVars, const vector< vector<Lit> >& clauses, vector<bool>& inAutarky);
+
+#endif // __AUTARKY_H
@@ -9,7 +9,6 @@
 //
 #define CAMUS_VERSION "1.0.5"
 
-#include "Solver.h"
 #include "mcsfinder.h"
 
 #include <time.h>
@@ -34,29 +33,55 @@ static char* prog_name;
 static void pusage() {
 	cerr
 	<< "CAMUS MCS version " << CAMUS_VERSION << endl
-	<< "usage: " << prog_name << " [options] FILE.cnf [FILE.MCSes]" << endl
+	<< "usage: " << prog_name << " [options] FILE.cnf|FILE.wcnf [FILE.MCSes]" << endl
 	<< endl
 	<< "Options:" << endl
 	<< "  -v      : verbose" << endl
 	<< "  -s      : report stats (runtime to STDERR)" << endl
 	<< "  -t n    : set an n second timeout" << endl
 	<< "  -j      : just solve the SAT instance (and report result if verbose is on)" << endl
-	<< "  -m      : solve Max-SAT by returning first MCS found (incompatible with -z, -x)" << endl
+	<< "  -m      : solve Max-SAT by returning first MCS found (incompatible with -z, -x); core-guided unless -u is given" << endl
 	<< "  -o      : find a single UNSAT core (usually not minimal) using the resolution DAG" << endl
-	<< "  -e      : find a single MUS (equivalent to '-z 1')" << endl
+	<< "  -e      : find a single MUS (by deletion, with clause-set refinement and model rotation)" << endl
+	<< "  -E      : find a single MUS, starting from the core found by -o" << endl
 	<< "  -x n    : set the bound/increment to n (NOTE: requires -u)" << endl
 	<< "  -z n    : truncate each MCS to n clauses" << endl
-	<< "  -g FILE : FILE contains groups of clauses (each line is a list of clause numbers (1-based counting) in a group)" << endl
-	<< "  -p FILE : FILE contains partitions over clauses (each line contains the last clause (1-based counting) in a partition)" << endl
+	<< "  -r      : with -z, print each PCS as soon as it is found; a PCS that is later subsumed is retracted with a line of '-' followed by that PCS" << endl
+	<< "  -g FILE : FILE contains groups of clauses (each line is a list of clause numbers (1-based counting) in a group; a line starting with 0 lists hard clauses)" << endl
+	<< "  -p FILE : FILE contains partitions over clauses (each line contains the last clause (1-based counting) in a partition; \"0 n\" makes one hard)" << endl
 	<< "  -y FILE : FILE contains clauses defined over the y variables" << endl
 	<< "  -l n    : only report MCSes below size n" << endl
+	<< "  -P      : simplify the formula (subsumption, variable elimination, failed literals) before searching for MCSes" << endl
+	<< "  -a      : leave out the clauses satisfied by the largest autarky (they are in no MCS or MUS)" << endl
+	<< "  -n      : first find the clauses in every MUS (by model rotation), report them as singleton MCSes, and leave them out of the search" << endl
+	<< "  -d      : search the variable-disjoint components of the formula separately (in parallel) and combine their MCSes (incompatible with -e, -z, -k)" << endl
+	<< "  -f p    : decide the y variables before all others, trying p first: 1 (keep the clause), 0 (drop it), or g (its value in the previous model)" << endl
+	<< "  -k FILE : write checkpoints of the search to FILE (every bound, and every minute as MCSes are found), first resuming from the one in FILE, if any; FILE is removed when the search is done" << endl
+	<< "  -J FILE : write statistics of the search to FILE as JSON (time per phase and per bound, time and SAT calls per MCS, peak memory, learnt clauses over time)" << endl
+	<< "  -c      : enumerate MCSes with clause-D calls instead of bounded search (no AtMost; MCSes are not output in order of size; incompatible with -m, -z)" << endl
 	<< "  -u      : disable unsat core extraction/guidance (not recommended: without using cores, CAMUS is much slower)" << endl
 	<< endl;
 	exit(1);
 }
 
+// for writing statistics (-J) on a timeout
+static MCSfinder* finder = NULL;
+
+// If the search hasn't stopped this long after interrupt() (within a single
+// long SAT call), the second alarm exits without the statistics
+#define TIMEOUT_GRACE 5
+
 // SIGALRM handler
 void alarm_handler(int sig) {
+	// with -J, the search writes the statistics and exits itself (writing
+	// them here would not be async-signal-safe)
+	static volatile sig_atomic_t interrupted = 0;
+	if (!interrupted && finder != NULL && finder->interrupt()) {
+		interrupted = 1;
+		alarm(TIMEOUT_GRACE);
+		return;
+	}
+
 	cerr << "Timeout reached." << endl;
 	exit(1);
 }
@@ -68,15 +93,17 @@ int main(int argc, char** argv) {
 	bool reportStats = false;
 	bool justSolve = false;
 	bool oneCore = false;
+	const char* checkpointFile = NULL;
 	
 	MCSfinder m;
+	finder = &m;
 
 	// command line parameters
 	prog_name = argv[0];
 	if (argc < 2) pusage();
 	while(1) {
 		// next option
-		int c = getopt(argc, argv, "vsjumoex:z:l:t:g:p:y:");
+		int c = getopt(argc, argv, "vsjumoeErcandPf:k:J:x:z:l:t:g:p:y:");
 		if (c == -1) break;
 
 		// handle option
@@ -87,9 +114,24 @@ int main(int argc, char** argv) {
 			case 'u': m.setUseCores(false); break;
 			case 'm': m.setMaxSAT(true); break;
 			case 'o': oneCore = true; break;
-			case 'e': m.setSizeLimit(1); break;
+			case 'e': m.setFindMUS(true); break;
+			case 'E': m.setFindMUS(true); m.setMUSFromCore(true); break;
 			case 'x': m.setBoundInc(atoi(optarg)); break;
 			case 'z': m.setSizeLimit(atoi(optarg)); break;
+			case 'r': m.setStreamPCSes(true); break;
+			case 'P': m.setPreprocess(true); break;
+			case 'c': m.setUseCLD(true); break;
+			case 'a': m.setPruneAutarky(true); break;
+			case 'n': m.setFindNecessary(true); break;
+			case 'd': m.setDecompose(true); break;
+			case 'f':
+				if (strcmp(optarg, "1") == 0)  m.setSelectorsFirst(PHASE_KEEP);
+				else if (strcmp(optarg, "0") == 0)  m.setSelectorsFirst(PHASE_DROP);
+				else if (strcmp(optarg, "g") == 0)  m.setSelectorsFirst(PHASE_GUIDED);
+				else  pusage();
+				break;
+			case 'k': checkpointFile = optarg; break;
+			case 'J': m.setStatsFile(optarg); break;
 			case 'l': m.setReportThreshold(atoi(optarg)); break;  // experimental
 			case 't': signal(SIGALRM, alarm_handler); alarm(atoi(optarg)); break;
 			case 'g': m.setClauseMap(optarg); break;  // grouping of clauses
@@ -101,7 +143,7 @@ int main(int argc, char** argv) {
 	}
 
 	// Read CNF input.
-	// Stores the formula in a data structure to fill Solver objects from that.
+	// Stores the formula in a data structure to fill SAT backends from that.
 	m.setCNF(argv[optind]);
 
 	if (optind+1 < argc) {
@@ -109,6 +151,11 @@ int main(int argc, char** argv) {
 		m.getMCSes(argv[optind+1]);
 	}
 
+	if (checkpointFile != NULL) {
+		// Resume from an earlier run's checkpoint, if there is one
+		m.setCheckpoint(checkpointFile);
+	}
+
 	// Solve the instance and exit (just to get some data on how long it takes to solve, plain)
 	if (justSolve) {
 		if (verbose)  cout << "Solving plain formula." << endl;
@@ -151,8 +198,8 @@ int main(int argc, char** argv) {
 	if (verbose) cout << endl << "Finding MCSes..." << endl;
 	m.findMCSes();
 
-	// TODO: report more finely - different stats, etc.
 	if (verbose)  m.printStats();
+	m.writeStats();
 	if (reportStats) cerr << setprecision(3) << CPUTIME - cpu_time << endl;
 
 	return 0;
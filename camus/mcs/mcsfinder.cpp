@@ -9,12 +9,25 @@
 
 #include "mcsfinder.h"
 #include <algorithm>
+#include <map>
+#include <sstream>
+#include <cstdio>
+#include <pthread.h>
+#include <unistd.h>
 
 using std::cout;
 using std::endl;
+using std::string;
+using std::ifstream;
+using std::ofstream;
+using std::istringstream;
+
+// Seconds between checkpoints (-k) written as MCSes are found
+static const time_t CHECKPOINT_INTERVAL = 60;
 
 retVal MCSfinder::solveRaw(Bag *retDeriv, Bag *exclude, int way) {
-	Solver s;
+	ScopedSAT scoped;
+	SATBackend& s = *scoped;
 	retVal ret;
 
 	if (retDeriv != NULL)
@@ -23,76 +36,81 @@ retVal MCSfinder::solveRaw(Bag *retDeriv, Bag *exclude, int way) {
 	if (p.get_CNF(s, exclude, way)) {
 		bool st = s.solve();
 		ret = (st) ? SAT : UNSAT;
-		if (verbose) addStats(cumulativeStats, s.stats);
-		if (verbose) addStats(cumulativeSATStats, s.stats);
+		addStats(cumulativeStats, s.stats());
+		addStats(cumulativeSATStats, s.stats());
 	}
 	else {
 		ret = UNSAT_EARLY;
 	}
 
 	if (retDeriv != NULL)
-		s.finalDeriv->getAncestorsSum(*retDeriv);
+		s.getDerivation(*retDeriv);
 
 	return ret;
 }
 
-// add clauses to a Solver
-bool MCSfinder::addBlockingClauses(Solver& sat) {
-	bool st = true;
-	foreach(vector<MCSBag>, it, MCSes) {
-		vec< Lit > newClause;
-		foreach(MCSBag, it2, *it) {
-			while (*it2 >= (unsigned)sat.nVars)  sat.newVar();
-			newClause.push(Lit(*it2+nvars));
-		}
-		if (st) {
-			if (newClause.size() == 1)
-				st = sat.addUnit(newClause[0]);
-			else
-				st = sat.addClause(newClause);
-		}
+void MCSfinder::setDecisions(SATBackend& sat, const SelectorMap& ymap) {
+	if (!selectorsFirst)  return;
+	for (unsigned int k = 0 ; k < ymap.size() ; k++) {
+		Var v = ymap.var(ymap.selector(k));
+		sat.prioritize(v);
+		sat.setPolarity(v, selectorPhase != PHASE_DROP);
 	}
-	return st;
 }
 
-// solve a single SAT problem, return TRUE if it's SAT, FALSE otherwise
-// do *not* clear the search tree (cancelUntil(0) like Solver::solve() does)
-//   so we can solve iteratively
-bool MCSfinder::itsolve(Solver& sat) {
-
-	SearchParams	params(0.95, 0.999, 0.02);
-	double  nof_conflicts = 100;
-	double  nof_learnts   = sat.nConstrs() / 3;
-
-	double grow_conflicts = 1.5;
-	double grow_learnts = 1.1;
-
-	sat.root_level = sat.decisionLevel;
+void MCSfinder::guidePhases(SATBackend& sat, const SelectorMap& ymap) {
+	if (!selectorsFirst || selectorPhase != PHASE_GUIDED)  return;
+	for (unsigned int k = 0 ; k < ymap.size() ; k++) {
+		Var v = ymap.var(ymap.selector(k));
+		sat.setPolarity(v, sat.model()[v]);
+	}
+}
 
-	lbool status = l_Undef;
+// output a single M/PCS (1-based clause/group indexes) on its own line
+// (or just collect it, for a component, see findMCSesByComponent())
+void MCSfinder::printMCS(const MCSBag& MCS) {
+	if (collected != NULL) {
+		collected->push_back(MCS);
+		return;
+	}
+	for (MCSBag::const_iterator it = MCS.begin() ; it != MCS.end() ; it++) {
+		cout << (*it+1) << " ";
+	}
+	cout << endl;
+}
 
-	while (status == l_Undef){
-		status = sat.search((int)nof_conflicts, (int)nof_learnts, params);
-		if (status == l_Undef) {
-			nof_conflicts *= grow_conflicts;
-			nof_learnts   *= grow_learnts;
+// add blocking clauses for the MCSes found so far to a SAT backend
+bool MCSfinder::addBlockingClauses(SATBackend& sat, const SelectorMap& ymap) {
+	bool st = true;
+	foreach(vector<MCSBag>, it, MCSes) {
+		if (isRetired(it))  continue;  // subsumed PCS
+		vec< Lit > newClause;
+		bool satisfied = false;
+		foreach(MCSBag, it2, *it) {
+			if (!ymap.inPlay(*it2)) {
+				// fixed TRUE, so this one is already satisfied
+				satisfied = true;
+				break;
+			}
+			newClause.push(ymap.lit(*it2));
 		}
+		if (satisfied)  continue;
+		if (st)  st = sat.addClause(newClause);
 	}
-
-	return (status == l_True);
+	return st;
 }
 
 // Grow an MSS from a seed satisfiable subset
-void MCSfinder::grow(Solver& growsat, Bag& MSS, Bag& MCS, const unsigned int lowbound, const unsigned int highbound) {
+// (each clause of the MCS is tried with the MSS so far as assumptions)
+void MCSfinder::grow(SATBackend& growsat, const SelectorMap& ymap, Bag& MSS, Bag& MCS, const unsigned int lowbound, const unsigned int highbound) {
+	PhaseTimer timer(profile, "grow");
 
 	if (verbose)  cout << "Started w/ size: " << MCS.size() << endl;
 
-	growsat.cancelUntil(0);
-
-	// first, inject the seed into the solver
+	// first, the seed
+	vec<Lit> assumps;
 	foreach (Bag, it, MSS) {
-		growsat.assume(Lit(*it + nvars));
-		growsat.propagate();
+		assumps.push(ymap.lit(*it));
 	}
 
 	unsigned int curSize = MCS.size();
@@ -105,15 +123,18 @@ void MCSfinder::grow(Solver& growsat, Bag& MSS, Bag& MCS, const unsigned int low
 		//cerr << "Trying to add " << i+1 << "... " << endl;
 
 		// try adding the current clause
-		bool st = growsat.assume(Lit(i + nvars));
+		assumps.push(ymap.lit(i));
 
-		if (st && growsat.propagate() == NULL && itsolve(growsat)) {
+		bool grown = growsat.solve(assumps);
+		numISAT++;
+		checkTimeout();
+		if (grown) {
 			// still satisfiable with current clause forced in
 
 			curSize--;	// because we know we're going to delete the current element,
 						// and this might help break the loop checking other clauses earlier
 
-			// Check for any "collateral" satisfied clauses (saves time, avoids calls to itsolve())
+			// Check for any "collateral" satisfied clauses (saves time, avoids calls to solve())
 			Bag::iterator it2 = it;
 			it2++;  // start at the following element
 			while (it2 != MCS.end()) {
@@ -125,13 +146,12 @@ void MCSfinder::grow(Solver& growsat, Bag& MSS, Bag& MCS, const unsigned int low
 
 				it2++;	// so we can erase the current element below if we want to
 
-				if (growsat.model[nvars+j] == 1) {
+				if (growsat.model()[ymap.var(j)] == 1) {
 					// found a "collateral" satisfied clause
 
 					//cerr << "--Removing " << j+1 << "." << endl;
 					MCS.erase(j);
-					growsat.assume(Lit(j + nvars));
-					growsat.propagate();
+					assumps.push(ymap.lit(j));
 					--curSize;
 					if (lowbound && curSize == lowbound) {
 						// done if we've reached the lower bound on MCS size
@@ -153,11 +173,10 @@ void MCSfinder::grow(Solver& growsat, Bag& MSS, Bag& MCS, const unsigned int low
 					foreach (vector<Lit>, curLit, clause) {
 						// compare it to the model in growsat
 						// remember, sign() returns 1 for negated, while the model holds 0 for negated...
-						if (growsat.model[var(*curLit)] != sign(*curLit)) {
+						if (growsat.model()[var(*curLit)] != sign(*curLit)) {
 							cerr << "--Removing " << j+1 << "." << endl;
 							MCS.erase(j);
-							growsat.assume(Lit(j + nvars));
-							growsat.propagate();
+							assumps.push(ymap.lit(j));
 							--curSize;
 							break;
 						}
@@ -179,51 +198,31 @@ void MCSfinder::grow(Solver& growsat, Bag& MSS, Bag& MCS, const unsigned int low
 		else {
 			it++; // because we're not using a for loop
 			//cerr << "Keeping " << i << "." << endl;
-			growsat.propQ.clear();
-			growsat.cancel();
+			assumps.pop();
 		}
 	}
 
-	growsat.cancelUntil(0);
-	growsat.root_level = growsat.decisionLevel;
-
 	if (verbose)  cout << "Ended w/ size: " << MCS.size() << endl;
 }
 
-bool MCSfinder::solve(Solver& sat, unsigned int lowbound, unsigned int highbound) {
+bool MCSfinder::solve(SATBackend& sat, const SelectorMap& ymap, unsigned int lowbound, unsigned int highbound) {
 
 	bool foundAny = false;
 
-	SearchParams	params(0.95, 0.999, 0.02);
-	double  nof_conflicts = 100;
-	double  nof_learnts   = sat.nConstrs() / 3;
+	bool status = true;
 
-	double grow_conflicts = 1.5;
-	double grow_learnts = 1.1;
+	while (status) {
 
-	sat.root_level = sat.decisionLevel;
-
-	lbool status = l_True;
-
-	while (status == l_True) {
-
-		status = l_Undef;
-
-		// main search loop
-		while (status == l_Undef){
-			status = sat.search((int)nof_conflicts, (int)nof_learnts, params);
-			if (status == l_Undef) {
-				nof_conflicts *= grow_conflicts;
-				nof_learnts   *= grow_learnts;
-			}
-		}
+		status = sat.solve();
 
 		numISAT++;
+		checkTimeout();
 
-		if (status == l_True) {
+		if (status) {
 			// have a solution
 
 			foundAny = true;
+			guidePhases(sat, ymap);
 
 			vec<Lit> newClause;
 			MCSBag newMCS; 
@@ -231,10 +230,12 @@ bool MCSfinder::solve(Solver& sat, unsigned int lowbound, unsigned int highbound
 			bool doGrow = (lowbound!=highbound);
 
 			// read the MSS/MCS from the current model
+			// (selectors not in play are fixed TRUE, so they are never in the MCS)
 			Bag testMSS;
 			Bag testMCS;
-			for (unsigned int i = 0 ; i < nYvars ; i++) {
-				if (sat.model[i+nvars] == false) {
+			for (unsigned int k = 0 ; k < ymap.size() ; k++) {
+				Num i = ymap.selector(k);
+				if (sat.model()[ymap.var(i)] == false) {
 					testMCS.insert(i);
 				}
 				else if (doGrow) {
@@ -243,7 +244,7 @@ bool MCSfinder::solve(Solver& sat, unsigned int lowbound, unsigned int highbound
 			}
 
 			if (doGrow && testMCS.size() != lowbound) {
-				grow(sat, testMSS, testMCS, /*p,*/ lowbound, highbound);
+				grow(sat, ymap, testMSS, testMCS, /*p,*/ lowbound, highbound);
 			}
 			else {
 				// no need to call grow() if we already have a smallest possible MCS
@@ -272,13 +273,14 @@ bool MCSfinder::solve(Solver& sat, unsigned int lowbound, unsigned int highbound
 				}
 
 				// Just take the first k elements
-				foreach(Bag, it, testMCS) {
+				// (advance the iterator before erasing so it is never used after the erase)
+				for (Bag::iterator it = testMCS.begin() ; it != testMCS.end() ; ) {
 					if (++counter > sizeLimit) {
 						break;
 					}
 if (verbose)  cout << endl << "Choosing: " << *it << endl;
 					newMCS.push_back(*it);
-					testMCS.erase(it);
+					testMCS.erase(it++);
 				}
 
 				// update ignored/cannotIgnore
@@ -287,7 +289,7 @@ if (verbose)  cout << endl << "Choosing: " << *it << endl;
 				// force out ignored clauses
 				foreach(Bag, it, testMCS) {
 					if (verbose)  cout << "Forcing out: " << (*it+1) << endl;
-					sat.addUnit(~Lit(*it+nvars));
+					sat.addUnit(~ymap.lit(*it));
 				}
 			}
 			else {
@@ -304,60 +306,221 @@ if (verbose)  cout << endl << "Choosing: " << *it << endl;
 			}
 
 			foreach(MCSBag, it, newMCS) {
-				// output MCS, IF we know it's safe (might not be w/ sizeLimit - see removeSubsumed)
-				if (sizeLimit == 0)
-					cout << (*it+1) << " ";
 				// build newClause
-				newClause.push(Lit(*it+nvars));
+				newClause.push(ymap.lit(*it));
 			}
+			// output MCS, IF we know it's safe (might not be w/ sizeLimit - see addMCS)
 			if (sizeLimit == 0)
-				cout << endl;
+				printMCS(newMCS);
 
 			if (maxSAT) return true;
 
-			MCSes.push_back(newMCS);
+			if (addMCS(newMCS) && sizeLimit > 0 && streamPCSes) {
+				printMCS(newMCS);
+			}
+			profile.sampleLearnts(sat.stats().learnts);
+			checkpointIfDue();
 
-			if (newClause.size() == 1)
-				status = sat.addUnit(newClause[0]);
-			else
-				status = sat.addClause(newClause);
+			status = sat.addClause(newClause);
 		}
 	}
 
 	return foundAny;
 }
 
-void MCSfinder::removeSubsumed() {
-	// TODO: Make this more efficient - only check the new MCSes, etc...
-	//       Might need to put it into solve()
-	//foreach(vector<MCSBag>, it, MCSes) {
-	for (unsigned i = 0 ; i < MCSes.size() ; i++) {
-		for(vector<MCSBag>::iterator it2 = MCSes.begin() ; it2 != MCSes.end() ; ) {
-			if (MCSes[i].size() < it2->size()  // also ensures it != it2
-				 && includes(it2->begin(),it2->end() , MCSes[i].begin(),MCSes[i].end())) {
-				//cerr << "OMG GOT ONE!" << endl;
-				it2 = MCSes.erase(it2);
-			 }
-			else {
-				it2++;
+bool MCSfinder::addMCS(const MCSBag& newMCS) {
+	profile.foundMCS(numSAT + numISAT);
+
+	if (sizeLimit) {
+		PhaseTimer timer(profile, "subsumption");
+
+		// Blocking clauses keep any later result from containing an earlier
+		// one, but a truncated PCS may still be a strict subset of earlier
+		// PCSes (once ignored clauses are dropped), and those are removed here.
+		if (pcsIndex.hasSubset(newMCS))  return false;
+
+		vector<unsigned int> subsumed;
+		pcsIndex.findSupersets(newMCS, subsumed);
+		retired.resize(MCSes.size());
+		foreach(vector<unsigned int>, it, subsumed) {
+			if (streamPCSes) {
+				// already printed, so retract it
+				cout << "- ";
+				printMCS(MCSes[*it]);
 			}
+			pcsIndex.remove(*it);
+			retired[*it] = true;
+		}
+
+		pcsIndex.insert(MCSes.size(), newMCS);
+	}
+
+	MCSes.push_back(newMCS);
+	return true;
+}
+
+// One line of a checkpoint: a tag, a list of indexes (plus offset), and 0
+template <class T>
+static void writeCheckpointList(ofstream& out, char tag, const T& items, unsigned int offset) {
+	out << tag;
+	for (typename T::const_iterator it = items.begin() ; it != items.end() ; it++) {
+		out << " " << (*it + offset);
+	}
+	out << " 0" << endl;
+}
+
+// The checkpoint is a text file with one item per line (indexes 1-based):
+//   p mcs <vars> <clauses> <y-vars> <-z limit>	(the formula it is for)
+//   b <bound>									(the bound being searched)
+//   i <selectors> 0							(included in the search)
+//   g <clauses> 0								(ignored, with -z)
+//   k <clauses> 0								(cannotIgnore, with -z)
+//   m <clauses> 0								(one per M/PCS found)
+// It is written to a temporary file and then renamed, so a run killed
+// while writing one leaves the previous one intact.
+void MCSfinder::saveCheckpoint() {
+	string tmpFile = string(checkpointFile) + ".tmp";
+	ofstream out(tmpFile.c_str());
+
+	out << "c camus_mcs checkpoint" << endl;
+	out << "p mcs " << nvars << " " << nclauses << " " << nYvars << " " << sizeLimit << endl;
+	out << "b " << searchBound << endl;
+	Bag included(searchIncluded);
+	included.erase(0);  // the id of clauses that come from no selector
+	writeCheckpointList(out, 'i', included, 0);
+	writeCheckpointList(out, 'g', ignored, 1);
+	writeCheckpointList(out, 'k', cannotIgnore, 1);
+	foreach(vector<MCSBag>, it, MCSes) {
+		if (isRetired(it))  continue;  // subsumed PCS
+		writeCheckpointList(out, 'm', *it, 1);
+	}
+	out.close();
+
+	if (out.fail() || rename(tmpFile.c_str(), checkpointFile) != 0) {
+		cerr << "Warning: Could not write checkpoint file " << checkpointFile << endl;
+	}
+	lastCheckpoint = time(NULL);
+}
+
+// The statistics (-J), as one JSON object
+void MCSfinder::writeStats(bool timedOut) {
+	if (statsFile == NULL)  return;
+	ofstream out(statsFile);
+	if (!out.good()) {cerr << "ERROR: Could not open file " << statsFile << endl; return;}
+
+	out << "{" << endl;
+	out << "  \"timed_out\": " << (timedOut ? "true" : "false") << "," << endl;
+	out << "  \"sat_calls\": " << numSAT + numISAT << "," << endl;
+	out << "  \"solver\": {\"starts\": " << cumulativeStats.starts
+		<< ", \"conflicts\": " << cumulativeStats.conflicts
+		<< ", \"decisions\": " << cumulativeStats.decisions
+		<< ", \"propagations\": " << cumulativeStats.propagations
+		<< ", \"inspects\": " << cumulativeStats.inspects << "}," << endl;
+	profile.writeJSON(out, "  ");
+	out << "}" << endl;
+}
+
+void MCSfinder::checkTimeout() {
+	if (timeUp) {
+		cerr << "Timeout reached." << endl;
+		writeStats(true);
+		exit(1);
+	}
+}
+
+void MCSfinder::checkpointIfDue() {
+	if (checkpointFile != NULL && time(NULL) - lastCheckpoint >= CHECKPOINT_INTERVAL) {
+		saveCheckpoint();
+	}
+}
+
+void MCSfinder::setCheckpoint(const char* file) {
+	checkpointFile = file;
+	searchBound = initialBound;
+
+	ifstream in(file);
+	if (!in.good())  return;  // nothing to resume from (yet)
+	if (!MCSes.empty()) {cerr << "ERROR: Can't resume from checkpoint " << file << " and read initial MCSes too." << endl; exit(1);}
+
+	bool haveHeader = false;
+	string line;
+	while (getline(in, line)) {
+		istringstream istr(line);
+		char tag = 0;
+		istr >> tag;
+
+		if (tag == 'c')  continue;  // comment
+		if (tag == 'p') {
+			string format;
+			unsigned int v, c, y, z;
+			istr >> format >> v >> c >> y >> z;
+			if (istr.fail() || format != "mcs") {cerr << "ERROR: Invalid checkpoint line: " << line << endl; exit(1);}
+			if (v != nvars || c != nclauses || y != nYvars || z != sizeLimit) {
+				cerr << "ERROR: Checkpoint " << file << " is for a different formula or -z limit." << endl;
+				exit(1);
+			}
+			haveHeader = true;
+			continue;
+		}
+		if (!haveHeader) {cerr << "ERROR: Invalid checkpoint line (before the 'p' line): " << line << endl; exit(1);}
+
+		if (tag == 'b') {
+			istr >> searchBound;
+			if (istr.fail() || searchBound == 0) {cerr << "ERROR: Invalid checkpoint line: " << line << endl; exit(1);}
+			continue;
+		}
+
+		// a list of 1-based indexes, ending in 0
+		MCSBag items;
+		unsigned int n;
+		while (istr >> n && n != 0) {
+			if (n > nYvars) {cerr << "ERROR: Invalid index " << n << " in checkpoint line: " << line << endl; exit(1);}
+			items.push_back(n-1);
+		}
+		string rest;
+		if (istr.fail() || istr >> rest) {cerr << "ERROR: Invalid checkpoint line: " << line << endl; exit(1);}
+
+		switch (tag) {
+			case 'i':
+				foreach(MCSBag, it, items)  searchIncluded.insert(*it+1);
+				break;
+			case 'g':
+				ignored.insert(items.begin(), items.end());
+				break;
+			case 'k':
+				cannotIgnore.insert(items.begin(), items.end());
+				break;
+			case 'm':
+				if (sizeLimit)  pcsIndex.insert(MCSes.size(), items);
+				MCSes.push_back(items);
+				break;
+			default:
+				cerr << "ERROR: Invalid checkpoint line: " << line << endl;
+				exit(1);
 		}
 	}
+	if (!haveHeader) {cerr << "ERROR: Invalid checkpoint file " << file << endl; exit(1);}
+
+	initialBound = searchBound;
+	if (verbose)  cout << "Resuming from checkpoint: " << MCSes.size() << " M/PCSes, bound " << initialBound << endl;
 }
 
 bool MCSfinder::checkForMore() {
+	PhaseTimer timer(profile, "check_for_more");
 	bool st = true;
-	Solver checkContinue;
+	ScopedSAT scoped;
+	SATBackend& checkContinue = *scoped;
+	SelectorMap ymap(nvars, nYvars, NULL, &necessary);  // all in play but the necessary clauses
 
 	// get the CNF
-	if (st)  st = p.get_CNF_Y(checkContinue);
+	if (st)  st = p.get_CNF_Y(checkContinue, ymap);
 
 	// force out previous results
-	if (st)  st = addBlockingClauses(checkContinue);
+	if (st)  st = addBlockingClauses(checkContinue, ymap);
 
 	// ignore/exclude clauses
 	foreach(Bag, it, ignored) {
-		checkContinue.addUnit(~Lit(*it + nvars));
+		checkContinue.addUnit(~ymap.lit(*it));
 	}
 
 	// no need for bound, we want to see if there's *anything* left
@@ -365,12 +528,721 @@ bool MCSfinder::checkForMore() {
 	// look for a solution
 	if (st)  st = checkContinue.solve();
 	numSAT++;
-	if (verbose) addStats(cumulativeStats, checkContinue.stats);
-	if (verbose) addStats(cumulativeSATStats, checkContinue.stats);
+	checkTimeout();
+	addStats(cumulativeStats, checkContinue.stats());
+	addStats(cumulativeSATStats, checkContinue.stats());
 
 	return st;
 }
 
+// Core-guided Max-SAT (OLL) in a single incremental Solver.
+//
+// Every y-var starts out as an assumption.  Each core (the assumptions
+// responsible for an UNSAT result) raises the lower bound by one: its
+// assumptions are dropped, and a new cardinality constraint over their
+// negations ("violations") is assumed to allow just one of them.  If a core
+// contains the assumption of such a constraint, that assumption is likewise
+// replaced by one allowing one more violation.  The first model found under
+// all current assumptions falsifies exactly lowerBound y-vars: a smallest MCS.
+//
+// The Solver's AtMost constraints can't be retracted, so each bound is
+// switched on by its own assumption literal a: AtMost over the violations
+// plus m padding literals ~f_1..~f_m (m = #violations - bound), allowing
+// bound+m, with (~a v ~f_i) for each i.  With a TRUE all the padding counts,
+// leaving room for only bound violations; without it, the f_i are free to be
+// TRUE (the Solver's default polarity) and the padding counts for nothing.
+Lit MCSfinder::addBoundAssumption(SATBackend& sat, const vector<Lit>& violations, unsigned int bound) {
+	Lit a = Lit(sat.newVar());
+
+	vec<Lit> ps;
+	for (unsigned int i = 0 ; i < violations.size() ; i++) {
+		ps.push(violations[i]);
+	}
+	unsigned int padding = violations.size() - bound;
+	for (unsigned int i = 0 ; i < padding ; i++) {
+		Lit pad = ~Lit(sat.newVar());
+		ps.push(pad);
+
+		vec<Lit> imp;
+		imp.push(~a);
+		imp.push(pad);
+		sat.addClause(imp);
+	}
+	sat.addAtMost(ps, bound + padding);
+
+	return a;
+}
+
+void MCSfinder::findMaxSAT() {
+	ScopedSAT scoped;
+	SATBackend& sat = *scoped;
+	SelectorMap ymap(nvars, nYvars, NULL, &necessary);  // all in play but the necessary clauses
+
+	bool st = p.get_CNF_Y(sat, ymap);
+	if (st)  st = addBlockingClauses(sat, ymap);
+
+	// current assumptions, and for each bound assumption, which cardinality constraint it belongs to
+	vector<Lit> assumps;
+	for (unsigned int k = 0 ; k < ymap.size() ; k++) {
+		assumps.push_back(ymap.lit(ymap.selector(k)));
+	}
+	std::map<Var, unsigned int> boundOf;
+	vector< vector<Lit> > cardViolations;
+	vector<unsigned int> cardBound;
+
+	unsigned int lowerBound = 0;
+
+	while (st) {
+		if (verbose) cout << "lower bound = " << lowerBound << ", assumptions = " << assumps.size() << endl;
+
+		vec<Lit> as;
+		for (unsigned int i = 0 ; i < assumps.size() ; i++) {
+			as.push(assumps[i]);
+		}
+		bool sol = sat.solve(as);
+		numISAT++;
+		checkTimeout();
+
+		if (sol) {
+			MCSBag MCS;
+			for (unsigned int k = 0 ; k < ymap.size() ; k++) {
+				Num y = ymap.selector(k);
+				if (sat.model()[ymap.var(y)] == false)  MCS.push_back(y);
+			}
+			profile.foundMCS(numSAT + numISAT);
+			printMCS(MCS);
+			break;
+		}
+
+		// the violations (negated assumptions) in the core
+		vec<Lit> conflict;
+		sat.conflict().copyTo(conflict);
+		if (conflict.size() == 0) {
+			// unsatisfiable regardless of the assumptions: no MCS left to find
+			break;
+		}
+
+		// try to shrink it by solving under just those assumptions
+		for (int round = 0 ; round < 3 && conflict.size() > 1 ; round++) {
+			vec<Lit> core;
+			for (int i = 0 ; i < conflict.size() ; i++) {
+				core.push(~conflict[i]);
+			}
+			bool coreSAT = sat.solve(core);
+			numISAT++;
+			checkTimeout();
+			if (coreSAT || sat.conflict().size() >= core.size()) {
+				// no progress (coreSAT can't really happen)
+				break;
+			}
+			sat.conflict().copyTo(conflict);
+		}
+		if (verbose) cout << "core size: " << conflict.size() << endl;
+
+		lowerBound++;
+
+		// drop the core's assumptions
+		std::set<Lit> inCore;
+		vector<Lit> violations;
+		for (int i = 0 ; i < conflict.size() ; i++) {
+			inCore.insert(~conflict[i]);
+			violations.push_back(conflict[i]);
+		}
+		unsigned int j = 0;
+		for (unsigned int i = 0 ; i < assumps.size() ; i++) {
+			if (inCore.find(assumps[i]) == inCore.end())  assumps[j++] = assumps[i];
+		}
+		assumps.resize(j);
+
+		// relax the bounds that were part of the core
+		foreach(std::set<Lit>, it, inCore) {
+			std::map<Var, unsigned int>::iterator b = boundOf.find(var(*it));
+			if (b == boundOf.end())  continue;
+
+			unsigned int c = b->second;
+			cardBound[c]++;
+			if (cardBound[c] < cardViolations[c].size()) {
+				Lit a = addBoundAssumption(sat, cardViolations[c], cardBound[c]);
+				boundOf[var(a)] = c;
+				assumps.push_back(a);
+			}
+		}
+
+		// and at most one of the core's violations
+		if (violations.size() > 1) {
+			unsigned int c = cardViolations.size();
+			cardViolations.push_back(violations);
+			cardBound.push_back(1);
+			Lit a = addBoundAssumption(sat, violations, 1);
+			boundOf[var(a)] = c;
+			assumps.push_back(a);
+		}
+
+		st = sat.okay();
+	}
+
+	addStats(cumulativeStats, sat.stats());
+	addStats(cumulativeISATStats, sat.stats());
+}
+
+void MCSfinder::getExtendedModel(SATBackend& sat, const SelectorMap& ymap, vec<bool>& model) {
+	sat.model().copyTo(model);
+	if (!p.isPreprocessed())  return;
+
+	// The Preprocessor has every selector, as variable nvars+y, and the
+	// selectors not in play are TRUE.  Extending the model never changes a
+	// selector (they are frozen), so only the clause variables are copied back.
+	vec<bool> full(nvars + nYvars, true);
+	for (unsigned int v = 0 ; v < nvars ; v++) {
+		full[v] = model[v];
+	}
+	for (unsigned int k = 0 ; k < ymap.size() ; k++) {
+		Num y = ymap.selector(k);
+		full[nvars + y] = model[ymap.var(y)];
+	}
+	p.extendModel(full);
+	for (unsigned int v = 0 ; v < nvars ; v++) {
+		model[v] = full[v];
+	}
+}
+
+void MCSfinder::moveSatisfied(SATBackend& sat, const SelectorMap& ymap, Bag& S, Bag& U) {
+	// With constraints on the y-vars, a satisfied clause can't be moved to
+	// S unless its y-var is TRUE, because S is asserted through the y-vars.
+	bool checkClauses = !p.hasYClauses();
+
+	vector<bool> satisfied(nYvars, true);
+	if (checkClauses) {
+		// clauses eliminated by preprocessing need the extended model
+		vec<bool> model;
+		getExtendedModel(sat, ymap, model);
+
+		vector<Lit> clause;
+		for (unsigned int i = 0 ; i < nclauses ; i++) {
+			if (p.isHard(i))  continue;
+			Num y = p.getClauseY(i);
+			if (!satisfied[y])  continue;
+
+			p.get_clause(i, clause);
+			bool clauseSAT = false;
+			foreach(vector<Lit>, lit, clause) {
+				// sign() is 1 for a negated literal, while the model holds 0 for FALSE
+				if (model[var(*lit)] != sign(*lit)) {
+					clauseSAT = true;
+					break;
+				}
+			}
+			// a group is satisfied only if all of its clauses are
+			if (!clauseSAT)  satisfied[y] = false;
+		}
+	}
+
+	for (Bag::iterator it = U.begin() ; it != U.end() ; ) {
+		Num y = *it;
+		it++;  // so we can erase y below
+		if (sat.model()[ymap.var(y)] == true || (checkClauses && satisfied[y])) {
+			S.insert(y);
+			U.erase(y);
+		}
+	}
+}
+
+// Clause-D MCS enumeration (CLD, as in MCSls), in a single incremental Solver.
+//
+// Each MCS is found from a model of the formula (with the blocking clauses for
+// the MCSes found so far): the clauses it satisfies form S, the rest U.  While
+// U is not an MCS, some clause of U can be satisfied along with all of S; a
+// single Solver call checks that, asserting S with its y-vars as assumptions
+// and adding D = (y_U1 v y_U2 v ...), the disjunction of the falsified
+// clauses.  A model moves every clause it satisfies from U to S.  Once D can't
+// be satisfied, U is an MCS, and the negations of the literals of every clause
+// in U are backbone literals of S (implied by it), so they need no separate
+// test: U is blocked with (y_U1 v y_U2 v ...) and the next model is sought.
+//
+// There is no cardinality constraint, so MCSes come out in no particular order
+// of size, but none is grown from a bounded search either.  Each D is added
+// with an activation literal and retired (by a unit) once it has been used.
+void MCSfinder::findMCSesCLD() {
+	if (maxSAT || sizeLimit) {
+		cerr << "ERROR: -c can't be combined with -m, -e, or -z." << endl;
+		exit(1);
+	}
+
+	ScopedSAT scoped;
+	SATBackend& sat = *scoped;
+	SelectorMap ymap(nvars, nYvars, NULL, &necessary);  // all in play but the necessary clauses
+
+	bool st = p.get_CNF_Y(sat, ymap);
+	if (st)  st = addBlockingClauses(sat, ymap);
+	setDecisions(sat, ymap);
+
+	while (st) {
+		// a model satisfying none of the MCSes found so far
+		st = sat.solve();
+		numSAT++;
+		checkTimeout();
+		if (!st)  break;
+		guidePhases(sat, ymap);
+
+		Bag S;
+		Bag U;
+		for (unsigned int k = 0 ; k < ymap.size() ; k++) {
+			U.insert(ymap.selector(k));
+		}
+		moveSatisfied(sat, ymap, S, U);
+
+		while (!U.empty()) {
+			Lit a = Lit(sat.newVar());
+
+			vec<Lit> D;
+			D.push(~a);
+			foreach(Bag, it, U) {
+				D.push(ymap.lit(*it));
+			}
+			sat.addClause(D);
+
+			vec<Lit> assumps;
+			foreach(Bag, it, S) {
+				assumps.push(ymap.lit(*it));
+			}
+			assumps.push(a);
+
+			bool more = sat.solve(assumps);
+			numISAT++;
+			checkTimeout();
+
+			// D is never needed again
+			sat.addUnit(~a);
+
+			if (!more)  break;
+
+			guidePhases(sat, ymap);
+			moveSatisfied(sat, ymap, S, U);
+		}
+
+		if (verbose)  cout << "MCS size: " << U.size() << endl;
+
+		MCSBag MCS(U.begin(), U.end());
+		if (reportThreshold == 0 || MCS.size() <= reportThreshold) {
+			printMCS(MCS);
+		}
+		addMCS(MCS);
+		profile.sampleLearnts(sat.stats().learnts);
+		checkpointIfDue();
+
+		// block it (an empty MCS means the formula is satisfiable: nothing more to find)
+		if (MCS.empty())  break;
+		vec<Lit> block;
+		foreach(MCSBag, it, MCS) {
+			block.push(ymap.lit(*it));
+		}
+		if (block.size() == 1)
+			st = sat.addUnit(block[0]);
+		else
+			st = sat.addClause(block);
+	}
+
+	addStats(cumulativeStats, sat.stats());
+	addStats(cumulativeISATStats, sat.stats());
+}
+
+// The clauses containing each variable (leaving out any outside the lean
+// kernel, see Parser::findLeanKernel())
+void MCSfinder::getOccurs(vector< vector<unsigned int> >& occurs) {
+	occurs.assign(nvars, vector<unsigned int>());
+	vector<Lit> clause;
+	for (unsigned int i = 0 ; i < nclauses ; i++) {
+		if (p.isPruned(i))  continue;
+		p.get_clause(i, clause);
+		foreach(vector<Lit>, lit, clause) {
+			occurs[var(*lit)].push_back(i);
+		}
+	}
+}
+
+static inline bool clauseSatisfied(const vector<Lit>& clause, const vec<bool>& model) {
+	for (unsigned int i = 0 ; i < clause.size() ; i++) {
+		// sign() is 1 for a negated literal, while the model holds 0 for FALSE
+		if (model[var(clause[i])] != sign(clause[i]))  return true;
+	}
+	return false;
+}
+
+// An assignment that falsifies only (clauses of) one necessary selector, and
+// the clauses it falsifies
+struct Rotation {
+	vec<bool> model;
+	vector<unsigned int> falsified;
+};
+
+// Model rotation (Marques-Silva and Lynce, "On Improving MUS Extraction
+// Algorithms", SAT 2011): flipping any one variable of the falsified clauses
+// gives a new assignment, and if the clauses it falsifies all belong to a
+// single other selector, that selector is necessary too, with the new
+// assignment as its witness.
+//
+// Starts from the model in sat, which satisfies every selector in inSet but
+// y, and adds the (1-based) ids of the necessary selectors found to found.
+// occurs lists the clauses containing each variable.
+void MCSfinder::rotateModel(SATBackend& sat, const SelectorMap& ymap, Num y, const vector< vector<unsigned int> >& occurs, const vector<bool>& inSet, Bag& found, unsigned int& numRotated) {
+	Rotation* start = new Rotation;
+	getExtendedModel(sat, ymap, start->model);  // clauses eliminated by preprocessing need the extended model
+	vector<Lit> clause;
+	for (unsigned int i = 0 ; i < nclauses ; i++) {
+		if (p.isHard(i) || p.getClauseY(i) != y || p.isPruned(i))  continue;
+		p.get_clause(i, clause);
+		if (!clauseSatisfied(clause, start->model))  start->falsified.push_back(i);
+	}
+
+	vector<Rotation*> todo;
+	todo.push_back(start);
+
+	while (!todo.empty()) {
+		Rotation* r = todo.back();
+		todo.pop_back();
+
+		// variables of the falsified clauses
+		std::set<Var> flips;
+		foreach(vector<unsigned int>, it, r->falsified) {
+			vector<Lit> clause;
+			p.get_clause(*it, clause);
+			foreach(vector<Lit>, lit, clause) {
+				flips.insert(var(*lit));
+			}
+		}
+
+		foreach(std::set<Var>, x, flips) {
+			r->model[*x] = !r->model[*x];
+
+			// every falsified clause with x in it is now satisfied, and a
+			// clause satisfied only through x is now falsified (and if that's
+			// a hard clause, the new assignment is no witness)
+			vector<unsigned int> falsified;
+			vector<Lit> clause;
+			foreach(vector<unsigned int>, it, r->falsified) {
+				p.get_clause(*it, clause);
+				if (!clauseSatisfied(clause, r->model))  falsified.push_back(*it);
+			}
+			bool hardFalsified = false;
+			for (unsigned int j = 0 ; !hardFalsified && j < occurs[*x].size() ; j++) {
+				unsigned int i = occurs[*x][j];
+				if (!p.isHard(i) && !inSet[p.getClauseY(i)])  continue;
+				p.get_clause(i, clause);
+				if (clauseSatisfied(clause, r->model))  continue;
+				if (p.isHard(i))  hardFalsified = true;
+				else if (find(falsified.begin(), falsified.end(), i) == falsified.end())  falsified.push_back(i);
+			}
+
+			Bag ys;
+			foreach(vector<unsigned int>, it, falsified) {
+				ys.insert(p.getClauseY(*it));
+			}
+			if (!hardFalsified && ys.size() == 1 && found.find(*ys.begin()+1) == found.end()) {
+				found.insert(*ys.begin()+1);
+				numRotated++;
+
+				Rotation* next = new Rotation;
+				r->model.copyTo(next->model);
+				next->falsified = falsified;
+				todo.push_back(next);
+			}
+
+			r->model[*x] = !r->model[*x];
+		}
+
+		delete r;
+	}
+}
+
+// Find necessary clauses (those in every MUS, i.e. singleton MCSes): a clause
+// c is necessary iff the formula without it is satisfiable.  Only clauses in a
+// core can be necessary, and any core found while testing one (the formula
+// without c is UNSAT) rules out every candidate not in it.  Each model found
+// for a necessary clause is rotated (see rotateModel()) to find more of them
+// without further SAT calls.
+void MCSfinder::findNecessary() {
+	// with constraints on the y-vars, an assignment falsifying only c's clauses
+	// may still violate them, so models can't be rotated
+	bool rotate = !p.hasYClauses();
+
+	Bag candidates = getCore();  // 1-based ids
+
+	vector< vector<unsigned int> > occurs;
+	if (rotate)  getOccurs(occurs);
+	vector<bool> all(nYvars, true);
+
+	ScopedSAT scoped;
+	SATBackend& sat = *scoped;
+	SelectorMap ymap(nvars, nYvars);  // all in play
+
+	bool st = p.get_CNF_Y(sat, ymap);
+
+	unsigned int numTested = 0;
+	unsigned int numRotated = 0;
+	while (st && !candidates.empty()) {
+		Num id = *candidates.begin();
+		candidates.erase(candidates.begin());
+		if (necessary.find(id) != necessary.end())  continue;  // found by rotation
+
+		// everything but c
+		vec<Lit> assumps;
+		for (Num y = 0 ; y < nYvars ; y++) {
+			assumps.push(y+1 == id ? ~ymap.lit(y) : ymap.lit(y));
+		}
+		bool sol = sat.solve(assumps);
+		numSAT++;
+		checkTimeout();
+		numTested++;
+
+		if (!sol) {
+			if (sat.conflict().size() == 0)  break;  // unsatisfiable without any clauses?
+
+			// only clauses in this core can be necessary
+			Bag core;
+			for (int i = 0 ; i < sat.conflict().size() ; i++) {
+				if (!sign(sat.conflict()[i]))  continue;  // ~c itself
+				core.insert(ymap.selectorOf(var(sat.conflict()[i])) + 1);
+			}
+			Bag dummy;
+			set_intersection(candidates.begin(), candidates.end(), core.begin(), core.end(), inserter(dummy, dummy.begin()));
+			candidates = dummy;
+			continue;
+		}
+
+		necessary.insert(id);
+
+		if (rotate)  rotateModel(sat, ymap, id-1, occurs, all, necessary, numRotated);
+	}
+
+	if (verbose) {
+		cout << "Necessary clauses: " << necessary.size() << " (" << numTested << " tested, " << numRotated << " found by model rotation)" << endl;
+	}
+	addStats(cumulativeStats, sat.stats());
+	addStats(cumulativeSATStats, sat.stats());
+}
+
+// Deletion-based extraction of a single MUS (-e) in one incremental Solver.
+//
+// The working set S starts as all of the clauses (or, with -E, as a core from
+// the resolution DAG, see getCore()), and each clause c in S is tested once:
+// solving with every other clause of S assumed and c left out.
+//  - UNSAT: c is not needed, and neither is any clause outside the core of
+//    that result (clause-set refinement); all of them leave S for good.
+//  - SAT: c is in the MUS, and rotating the model (see rotateModel()) often
+//    shows other clauses of S to be in it as well, without testing them.
+// What is left of S at the end is an MUS, printed one clause per line as -z 1
+// would (and as camus_mus reads them, as singletons).
+void MCSfinder::findMUS() {
+	if (maxSAT || sizeLimit || useCLD) {
+		cerr << "ERROR: -e can't be combined with -m, -z, or -c." << endl;
+		exit(1);
+	}
+
+	// with constraints on the y-vars, an assignment falsifying only c's clauses
+	// may still violate them, so models can't be rotated
+	bool rotate = !p.hasYClauses();
+
+	vector<bool> inSet(nYvars, !MUSFromCore);
+	if (MUSFromCore) {
+		Bag core = getCore();  // 1-based ids
+		foreach(Bag, it, core) {
+			inSet[*it-1] = true;
+		}
+	}
+	else {
+		// selectors fixed TRUE by Parser::findLeanKernel() are in no MUS
+		for (Num y = 0 ; y < nYvars ; y++) {
+			if (p.isPrunedY(y))  inSet[y] = false;
+		}
+	}
+
+	// clauses known to be in the MUS (1-based ids)
+	Bag MUS;
+	if (detectNecessary) {
+		// in every MUS, so certainly in S
+		findNecessary();
+		MUS = necessary;
+	}
+
+	ScopedSAT scoped;
+	SATBackend& sat = *scoped;
+	SelectorMap ymap(nvars, nYvars);  // all in play
+
+	bool st = p.get_CNF_Y(sat, ymap);
+
+	// clauses outside S are out for good (other than those the Parser has
+	// already left out)
+	for (Num y = 0 ; st && y < nYvars ; y++) {
+		if (!inSet[y] && !p.isPrunedY(y))  st = sat.addUnit(~ymap.lit(y));
+	}
+
+	// the deletions below assume S is unsatisfiable; if the formula is
+	// satisfiable, its only MCS is the empty one
+	bool satisfiable = false;
+	if (st) {
+		vec<Lit> assumps;
+		for (Num y = 0 ; y < nYvars ; y++) {
+			if (inSet[y])  assumps.push(ymap.lit(y));
+		}
+		satisfiable = sat.solve(assumps);
+		numSAT++;
+		checkTimeout();
+		if (satisfiable)  printMCS(MCSBag());
+	}
+
+	vector< vector<unsigned int> > occurs;
+	if (rotate && !satisfiable)  getOccurs(occurs);
+
+	unsigned int numTested = 0;
+	unsigned int numRotated = 0;
+	for (Num y = 0 ; st && !satisfiable && y < nYvars ; y++) {
+		if (!inSet[y] || MUS.find(y+1) != MUS.end())  continue;
+
+		// S without y
+		vec<Lit> assumps;
+		for (Num y2 = 0 ; y2 < nYvars ; y2++) {
+			if (inSet[y2])  assumps.push(y2 == y ? ~ymap.lit(y2) : ymap.lit(y2));
+		}
+		bool sol = sat.solve(assumps);
+		numSAT++;
+		checkTimeout();
+		numTested++;
+
+		if (!sol) {
+			if (sat.conflict().size() == 0)  break;  // unsatisfiable without any clauses?
+
+			// keep only the clauses in this core
+			vector<bool> inCore(nYvars, false);
+			for (int i = 0 ; i < sat.conflict().size() ; i++) {
+				if (sign(sat.conflict()[i]))  inCore[ymap.selectorOf(var(sat.conflict()[i]))] = true;
+			}
+			for (Num y2 = 0 ; st && y2 < nYvars ; y2++) {
+				if (inSet[y2] && !inCore[y2] && MUS.find(y2+1) == MUS.end()) {
+					inSet[y2] = false;
+					st = sat.addUnit(~ymap.lit(y2));
+				}
+			}
+			continue;
+		}
+
+		MUS.insert(y+1);
+		if (rotate)  rotateModel(sat, ymap, y, occurs, inSet, MUS, numRotated);
+	}
+
+	foreach(Bag, it, MUS) {
+		printMCS(MCSBag(1, *it-1));
+	}
+
+	if (verbose) {
+		cout << "MUS size: " << MUS.size() << " (" << numTested << " tested, " << numRotated << " found by model rotation)" << endl;
+	}
+	addStats(cumulativeStats, sat.stats());
+	addStats(cumulativeSATStats, sat.stats());
+}
+
+// Work queue shared by the threads searching components
+struct ComponentQueue {
+	vector<MCSfinder*>* parts;
+	unsigned int next;
+	pthread_mutex_t lock;
+};
+
+static void* componentWorker(void* arg) {
+	ComponentQueue* q = (ComponentQueue*)arg;
+	while (true) {
+		pthread_mutex_lock(&q->lock);
+		unsigned int i = q->next++;
+		pthread_mutex_unlock(&q->lock);
+		if (i >= q->parts->size())  break;
+
+		(*q->parts)[i]->findMCSes();
+	}
+	return NULL;
+}
+
+// Search each component (see Parser::getComponents()) on its own, in
+// parallel.  Every MCS of the formula is the union of one MCS of each
+// component (the empty set, for a satisfiable one), so the results are
+// combined by stepping through their cartesian product, printing each union
+// as it is formed (never storing the product).  The components' searches
+// share the options of this one, but have their own Parsers (with just their
+// clauses, renumbered) and collect their MCSes rather than printing them.
+void MCSfinder::findMCSesByComponent(const vector< vector<Num> >& components, const vector< vector<unsigned int> >& hard) {
+	vector< vector<MCSBag> > results(components.size());
+	vector<MCSfinder*> parts;
+	for (unsigned int c = 0 ; c < components.size() ; c++) {
+		MCSfinder* f = new MCSfinder();
+		f->boundinc = boundinc;
+		f->initialBound = initialBound;
+		f->reportThreshold = reportThreshold;
+		f->useCores = useCores;
+		f->maxSAT = maxSAT;
+		f->useCLD = useCLD;
+		f->detectNecessary = detectNecessary;
+		f->selectorsFirst = selectorsFirst;
+		f->selectorPhase = selectorPhase;
+		f->p.extractComponent(p, components[c], hard[c]);
+		f->setPreprocess(preprocess);
+		f->nvars = f->p.getCNFvars();
+		f->nclauses = f->p.getCNFclauses();
+		f->nYvars = f->p.getYvars();
+		f->collected = &results[c];
+		parts.push_back(f);
+	}
+
+	unsigned int numThreads = sysconf(_SC_NPROCESSORS_ONLN);
+	if (numThreads < 1)  numThreads = 1;
+	if (numThreads > parts.size())  numThreads = parts.size();
+
+	ComponentQueue q;
+	q.parts = &parts;
+	q.next = 0;
+	pthread_mutex_init(&q.lock, NULL);
+	vector<pthread_t> threads(numThreads);
+	for (unsigned int t = 0 ; t < numThreads ; t++) {
+		if (pthread_create(&threads[t], NULL, componentWorker, &q) != 0) {
+			cerr << "ERROR: Could not create a thread." << endl;
+			exit(1);
+		}
+	}
+	for (unsigned int t = 0 ; t < numThreads ; t++) {
+		pthread_join(threads[t], NULL);
+	}
+	pthread_mutex_destroy(&q.lock);
+
+	for (unsigned int c = 0 ; c < parts.size() ; c++) {
+		if (verbose)  cout << "Component " << c+1 << ": " << results[c].size() << " MCSes" << endl;
+		numSAT += parts[c]->numSAT;
+		numISAT += parts[c]->numISAT;
+		addStats(cumulativeStats, parts[c]->cumulativeStats);
+		delete parts[c];
+		if (results[c].empty())  return;  // can't happen (a satisfiable component gives an empty MCS)
+	}
+
+	// step through the product like an odometer
+	vector<unsigned int> pick(components.size(), 0);
+	while (true) {
+		MCSBag MCS;
+		for (unsigned int c = 0 ; c < components.size() ; c++) {
+			foreach(MCSBag, it, results[c][pick[c]]) {
+				MCS.push_back(components[c][*it]);
+			}
+		}
+		sort(MCS.begin(), MCS.end());
+		if (reportThreshold == 0 || MCS.size() <= reportThreshold) {
+			printMCS(MCS);
+		}
+		if (maxSAT)  break;  // a smallest MCS of each component
+
+		unsigned int c = 0;
+		while (c < pick.size() && ++pick[c] == results[c].size()) {
+			pick[c] = 0;
+			c++;
+		}
+		if (c == pick.size())  break;
+	}
+}
+
 // Search for MCSes once the instance has been setup and options set
 void MCSfinder::findMCSes() {
 	bool st;
@@ -378,7 +1250,102 @@ void MCSfinder::findMCSes() {
 
 	Bag included;
 
+	if (p.getNumHard() > 0) {
+		PhaseTimer timer(profile, "hard_check");
+		// with no selectors, nothing could be relaxed to satisfy them
+		Bag all;
+		for (Num y = 0 ; y < nYvars ; y++) {
+			all.insert(y+1);
+		}
+		if (solveRaw(NULL, &all) != SAT) {
+			cerr << "ERROR: The hard clauses are unsatisfiable." << endl;
+			exit(1);
+		}
+		if (verbose)  cout << "Hard clauses: " << p.getNumHard() << endl;
+	}
+
+	if (pruneAutarky) {
+		PhaseTimer timer(profile, "autarky");
+		p.findLeanKernel();
+		if (verbose)  cout << "Autarky: " << p.getNumPruned() << " clauses outside the lean kernel" << endl;
+	}
+
+	if (decompose) {
+		if (sizeLimit || findOneMUS || !MCSes.empty() || checkpointFile != NULL || statsFile != NULL) {
+			cerr << "Warning: -d can't be used with -e, -z, -k, -J, or initial MCSes... ignoring -d." << endl;
+		}
+		else {
+			vector< vector<Num> > components;
+			vector< vector<unsigned int> > hard;
+			p.getComponents(components, hard);
+			if (verbose)  cout << "Components: " << components.size() << endl;
+			if (components.size() > 1) {
+				PhaseTimer timer(profile, "components");
+				findMCSesByComponent(components, hard);
+				return;
+			}
+		}
+	}
+
+	if (preprocess) {
+		PhaseTimer timer(profile, "preprocess");
+		p.preprocessCNF_Y();
+		if (verbose) {
+			const Preprocessor* pre = p.getPreprocessor();
+			cout << "Preprocessing: " << pre->numEliminated << " vars eliminated, "
+				<< pre->numSubsumed << " clauses subsumed, "
+				<< pre->numStrengthened << " clauses strengthened, "
+				<< pre->numFailed << " failed literals" << endl;
+		}
+	}
+
+	if (findOneMUS) {
+		PhaseTimer timer(profile, "mus");
+		findMUS();
+		return;
+	}
+
+	if (detectNecessary) {
+		PhaseTimer timer(profile, "necessary");
+		findNecessary();
+
+		// necessary clauses are singleton MCSes, reported before any others
+		foreach(Bag, it, necessary) {
+			MCSBag MCS(1, *it-1);
+			bool known = false;  // already read from the initial MCSes?
+			foreach(vector<MCSBag>, it2, MCSes) {
+				if (*it2 == MCS)  known = true;
+			}
+			if (known)  continue;
+
+			if (addMCS(MCS) && (sizeLimit == 0 || streamPCSes)) {
+				printMCS(MCS);
+			}
+			if (maxSAT)  return;  // no smaller MCS
+		}
+	}
+
+	if (useCLD) {
+		PhaseTimer timer(profile, "cld_search");
+		findMCSesCLD();
+		if (checkpointFile != NULL)  remove(checkpointFile);  // done
+		return;
+	}
+	if (maxSAT && useCores) {
+		PhaseTimer timer(profile, "maxsat");
+		findMaxSAT();
+		return;
+	}
+
+	if (!useCores && MCSes.empty() && solveRaw() == SAT) {
+		// the bounded search only finds MCSes of size bound and up, so it
+		// would miss the (only) empty one
+		printMCS(MCSBag());
+		return;
+	}
+
 	if (useCores) {
+		PhaseTimer timer(profile, "initial_core");
 		// Multiple cores
 		/*
 		unsigned int numCores = 0;
@@ -398,6 +1365,9 @@ void MCSfinder::findMCSes() {
 		included = getCore();
 		//*/
 
+		// and any included before a checkpoint we resumed from
+		included.insert(searchIncluded.begin(), searchIncluded.end());
+
 		if (verbose) {
 			cout << "Initial core count: " << numCores << endl;
 			cout << "Initial core(s): " << endl;
@@ -409,56 +1379,77 @@ void MCSfinder::findMCSes() {
 		}
 	}
 
-	while (true) {
+	// nothing more to find if every MCS is a necessary clause
+	bool searching = necessary.empty() || checkForMore();
+
+	while (searching) {
 		if (verbose) cout << "bound = " << bound << endl;
 
+		// every bound below this one is done
+		searchBound = bound;
+		searchIncluded = included;
+		if (checkpointFile != NULL)  saveCheckpoint();
+
 		bool foundAny = false;
+		double startWall = Profile::wallTime();
+		double startCPU = Profile::cpuTime();
+		unsigned int startMCSes = MCSes.size();
+		int startCalls = numSAT + numISAT;
 
 		// find MCSes
 		st = true;
-		Solver findMCSes;
+		ScopedSAT scoped;
+		SATBackend& findMCSes = *scoped;
 		if (useCores) {
 			findMCSes.enableDeriv();
 		}
 
+		// only the y-vars in the current core (or all of them, without cores)
+		// are in play, minus any necessary clauses; the rest are fixed TRUE
+		// and get no variables at all
+		SelectorMap ymap(nvars, nYvars, (useCores) ? &included : NULL, &necessary);
+
 		// get the CNF
-		if (st)  st = p.get_CNF_Y(findMCSes, (useCores) ? &included : NULL);
+		if (st)  st = p.get_CNF_Y(findMCSes, ymap);
+		setDecisions(findMCSes, ymap);
 
 		// force out previous results
-		if (st)  st = addBlockingClauses(findMCSes);
+		if (st)  st = addBlockingClauses(findMCSes, ymap);
 
 		// ignore/exclude clauses
+		Bag enabledIgnored;
 		foreach(Bag, it, ignored) {
-			findMCSes.addUnit(~Lit(*it + nvars));
+			if (ymap.inPlay(*it)) {
+				findMCSes.addUnit(~ymap.lit(*it));
+			}
+			else {
+				// The clause is enabled, so it can't be forced out; record it
+				// with the derivation so the next core includes it.
+				enabledIgnored.insert(*it+1);
+			}
 		}
 
 		// add bound(s) on y-vars
 		vec<Lit> ps;
-		for (unsigned int i = 0 ; i < nYvars ; i++) {
-			// If we're not using cores (standard AtMost
-			// w/ all yvars) OR if we are and this is in
-			// the set we're supposed to include:
-			if (!useCores
-					||
-					included.find(i+1) != included.end())
-				ps.push(~Lit(nvars+i));
+		for (unsigned int k = 0 ; k < ymap.size() ; k++) {
+			ps.push(~ymap.lit(ymap.selector(k)));
 		}
 		if (st)  st = findMCSes.addAtMost(ps, bound);
 
 		// look for some MCSes
-		if (st)  foundAny = solve(findMCSes, bound-boundinc+1, bound);
+		if (st)  foundAny = solve(findMCSes, ymap, bound-boundinc+1, bound);
 
-		if (verbose) printStatsSet(findMCSes.stats);
-		if (verbose) addStats(cumulativeStats, findMCSes.stats);
-		if (verbose) addStats(cumulativeISATStats, findMCSes.stats);
+		if (verbose) printStatsSet(findMCSes.stats());
+		addStats(cumulativeStats, findMCSes.stats());
+		addStats(cumulativeISATStats, findMCSes.stats());
+		profile.addBound(bound, Profile::wallTime() - startWall, Profile::cpuTime() - startCPU,
+			MCSes.size() - startMCSes, numSAT + numISAT - startCalls, findMCSes.stats().conflicts, ymap.size());
+		profile.addTime("bound_search", Profile::wallTime() - startWall, Profile::cpuTime() - startCPU);
+		profile.sampleLearnts(findMCSes.stats().learnts, true);
 
 		if (foundAny && maxSAT) break;
 
-		// check for (and remove) subsumed MCSes (only needed if we're using sizeLimit)
-		if (sizeLimit > 0) {
-			if (verbose)  cout << "removing subsumed M/PCSes (" << MCSes.size() << " total)" << endl;
-			removeSubsumed();
-		}
+		if (verbose && sizeLimit > 0)  cout << "unsubsumed M/PCSes: " << pcsIndex.size() << endl;
 
 		// Check to see if we need to continue
 		// only need to check when previous run found some result
@@ -477,7 +1468,8 @@ void MCSfinder::findMCSes() {
 
 		// Update included with the derivation of this infeasibility
 		if (useCores) {
-			findMCSes.finalDeriv->getAncestorsSum(included);  // adds to included
+			findMCSes.getDerivation(included);  // adds to included
+			included.insert(enabledIgnored.begin(), enabledIgnored.end());
 			if (verbose) {
 				cout << "findMCSes US: " << endl;
 				for (Bag::iterator it = included.begin() ; it != included.end() ; it++) {
@@ -492,15 +1484,14 @@ void MCSfinder::findMCSes() {
 		bound += boundinc;
 	}
 
-
-	// TODO: Integrate this w/ only checking new MCSes so we can see *something* as it goes...
-	if (sizeLimit > 0) {
+	// PCSes are only printed at the end unless they were streamed as found
+	if (sizeLimit > 0 && !streamPCSes) {
 		foreach(vector<MCSBag>, it, MCSes) {
-			foreach(MCSBag, it2, *it) {
-				cout << *it2+1 << " ";
-			}
-			cout << endl;
+			if (isRetired(it))  continue;  // subsumed PCS
+			printMCS(*it);
 		}
 	}
+
+	if (checkpointFile != NULL)  remove(checkpointFile);  // done
 }
 
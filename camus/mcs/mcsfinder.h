@@ -11,16 +11,25 @@
 
 #include "defs.h"
 #include "parser.h"
+#include "satbackend.h"
+#include "subsumption.h"
+#include "profile.h"
 #include <iostream>
 #include <fstream>
 #include <vector>
 #include <set>
 #include <algorithm>
+#include <ctime>
+#include <signal.h>
 
 using std::cout;
 using std::cerr;
 using std::endl;
 
+// The value tried first for a selector when they are decided first (-f):
+// TRUE (keep its clauses), FALSE, or its value in the last model found
+enum SelectorPhase { PHASE_KEEP, PHASE_DROP, PHASE_GUIDED };
+
 class MCSfinder {
 private:
 	Parser p;
@@ -36,6 +45,41 @@ private:
 	unsigned int reportThreshold;
 	bool useCores;
 	bool maxSAT;
+	// Enumerate with the clause-D engine (findMCSesCLD()) instead of bounded search
+	bool useCLD;
+	// With sizeLimit, print each PCS as soon as it is found (rather than all
+	// at the end), and print a retraction ("- " followed by the PCS) for any
+	// printed PCS that is later subsumed.
+	bool streamPCSes;
+	// Simplify the instrumented formula once up front (see Parser::preprocessCNF_Y())
+	bool preprocess;
+	// Extract a single MUS (findMUS()) instead of finding MCSes, starting from
+	// a core if MUSFromCore
+	bool findOneMUS;
+	bool MUSFromCore;
+	// Find the necessary clauses up front (findNecessary()) and fix them TRUE
+	bool detectNecessary;
+	// Leave out the clauses outside the lean kernel (see Parser::findLeanKernel())
+	bool pruneAutarky;
+	// Search the formula's components separately (findMCSesByComponent())
+	bool decompose;
+	// If set, MCSes are added here instead of being printed (see printMCS())
+	vector<MCSBag>* collected;
+	// Decide the selectors before any other variable (see setDecisions())
+	bool selectorsFirst;
+	SelectorPhase selectorPhase;
+	// Checkpointing (-k): the file and when it was last written, and the
+	// state of the bounded search to resume from (the bound being searched,
+	// and the selectors included when it started)
+	const char* checkpointFile;
+	time_t lastCheckpoint;
+	unsigned int searchBound;
+	Bag searchIncluded;
+	// Statistics written as JSON to statsFile at the end (-J), see writeStats()
+	const char* statsFile;
+	Profile profile;
+	// Set (from a signal handler, see interrupt()) once the time is up
+	volatile sig_atomic_t timeUp;
 
 	unsigned int nvars;
 	unsigned int nclauses;
@@ -45,23 +89,69 @@ private:
 	Bag ignored;
 	Bag cannotIgnore;
 
-	// add clauses to a Solver
-	bool addBlockingClauses(Solver& sat);
+	// necessary clauses (1-based), already reported as singleton MCSes, and
+	// fixed TRUE (no y-vars) in every search
+	Bag necessary;
+
+	// Index over MCSes (by position in the MCSes vector) for finding subsumed
+	// PCSes as they are found (only used with sizeLimit).  Subsumed entries
+	// stay in MCSes so positions don't change, but are flagged in retired and
+	// must be skipped wherever MCSes is read.
+	SubsumptionIndex pcsIndex;
+	vector<bool> retired;
+	bool isRetired(vector<MCSBag>::const_iterator it) const {
+		unsigned int i = it - MCSes.begin();
+		return i < retired.size() && retired[i];
+	}
 
-	// solve a single SAT problem, return TRUE if it's SAT, FALSE otherwise
-	// do *not* clear the search tree (cancelUntil(0) like Solver::solve() does)
-	//   so we can solve iteratively
-	bool itsolve(Solver& sat);
+	// add blocking clauses for the MCSes found so far to a SAT backend
+	bool addBlockingClauses(SATBackend& sat, const SelectorMap& ymap);
 
 	// Grow an MSS from a seed satisfiable subset
-	void grow(Solver& growsat, Bag& MSS, Bag& MCS, const unsigned int lowbound=0, const unsigned int highbound=0);
+	void grow(SATBackend& growsat, const SelectorMap& ymap, Bag& MSS, Bag& MCS, const unsigned int lowbound=0, const unsigned int highbound=0);
+
+	bool solve(SATBackend& sat, const SelectorMap& ymap, unsigned int lowbound = 0, unsigned int highbound=0);
+
+	// Add a cardinality constraint allowing at most bound of the given
+	// violations that is enforced only when the returned literal is assumed
+	Lit addBoundAssumption(SATBackend& sat, const vector<Lit>& violations, unsigned int bound);
+
+	// Copy the backend's current model (numbered as in ymap) into model,
+	// filling in the variables removed by preprocessing
+	void getExtendedModel(SATBackend& sat, const SelectorMap& ymap, vec<bool>& model);
+
+	// Move the selectors in U whose clauses are satisfied by the backend's
+	// current model (or whose y-vars are TRUE in it) into S
+	void moveSatisfied(SATBackend& sat, const SelectorMap& ymap, Bag& S, Bag& U);
+
+	// Fill necessary with clauses in every MUS (singleton MCSes)
+	void findNecessary();
+	void getOccurs(vector< vector<unsigned int> >& occurs);
+	void rotateModel(SATBackend& sat, const SelectorMap& ymap, Num y, const vector< vector<unsigned int> >& occurs, const vector<bool>& inSet, Bag& found, unsigned int& numRotated);
+
+	// Put the selectors in play first in the backend's decision order, with
+	// the phase given by selectorPhase (if selectorsFirst)
+	void setDecisions(SATBackend& sat, const SelectorMap& ymap);
+	// With PHASE_GUIDED, try the selectors' values in the current model first
+	void guidePhases(SATBackend& sat, const SelectorMap& ymap);
 
-	bool solve(Solver& sat, unsigned int lowbound = 0, unsigned int highbound=0);
+	// Write the checkpoint (replacing the last one), or only once enough
+	// time has passed since the last one (checkpointIfDue())
+	void saveCheckpoint();
+	void checkpointIfDue();
+
+	// After interrupt(), write the statistics and exit (called after each
+	// SAT call, where that is safe, rather than in the signal handler)
+	void checkTimeout();
 
 	// Check to see if there are any more MCSes (i.e., if the instance is SAT even with blocking clauses for all MCSes found so far)
 	bool checkForMore();
 
-	void removeSubsumed();
+	void printMCS(const MCSBag& MCS);
+
+	// Store a new M/PCS, first removing any stored PCSes it subsumes.
+	// Returns FALSE if the new PCS is itself subsumed (and therefore not stored).
+	bool addMCS(const MCSBag& newMCS);
 
 	// solver stats reporting
 	SolverStats cumulativeStats;
@@ -70,7 +160,7 @@ private:
 	int numISAT;
 	SolverStats cumulativeSATStats;
 	SolverStats cumulativeISATStats;
-	static void addStats(SolverStats& to, SolverStats& from) {
+	static void addStats(SolverStats& to, const SolverStats& from) {
 		to.starts += from.starts;
 		to.conflicts += from.conflicts;
 		to.decisions += from.decisions;
@@ -88,6 +178,22 @@ public:
 		reportThreshold(0),
 		useCores(true),
 		maxSAT(false),
+		useCLD(false),
+		streamPCSes(false),
+		preprocess(false),
+		findOneMUS(false),
+		MUSFromCore(false),
+		detectNecessary(false),
+		pruneAutarky(false),
+		decompose(false),
+		collected(NULL),
+		selectorsFirst(false),
+		selectorPhase(PHASE_KEEP),
+		checkpointFile(NULL),
+		lastCheckpoint(0),
+		searchBound(1),
+		statsFile(NULL),
+		timeUp(0),
 		nvars(0),
 		nclauses(0),
 		nYvars(0),
@@ -135,18 +241,40 @@ public:
 	// Search for MCSes once the instance has been setup and options set
 	void findMCSes();
 
+	// Find a single smallest MCS (-m) with the core-guided engine
+	void findMaxSAT();
+
+	// Find all MCSes (-c) with the clause-D engine (no cardinality constraints)
+	void findMCSesCLD();
+
+	// Find a single MUS (-e), by deletion
+	void findMUS();
+
+	// Find all MCSes (-d) by combining those of the formula's components
+	void findMCSesByComponent(const vector< vector<Num> >& components, const vector< vector<unsigned int> >& hard);
+
 	void setCNF(const char* file) {
+		PhaseTimer timer(profile, "parse");
 		p.parseCNF(file);
 		nvars = p.getCNFvars();
 		nclauses = p.getCNFclauses();
 		nYvars = p.getYvars();
 	}
 	void getMCSes(const char* file) {
+		PhaseTimer timer(profile, "parse");
 		MCSes = p.parseMCSes(file);
+		if (sizeLimit) {
+			for (unsigned int i = 0 ; i < MCSes.size() ; i++) {
+				pcsIndex.insert(i, MCSes[i]);
+			}
+		}
 
 		// Set the initial bound based on the largest MCS we've seen
-		// NOTE that this assumes they were entered in increasing order of size!
-		initialBound = MCSes.back().size();
+		// (all MCSes up to that size must be included)
+		initialBound = 0;
+		foreach(vector<MCSBag>, it, MCSes) {
+			initialBound = std::max(initialBound, (unsigned int)it->size());
+		}
 
 		// Check to see if we have everything already (just in case someone tries to get clever)
 		if (!checkForMore()) {
@@ -157,11 +285,31 @@ public:
 	void setPartition(const char* file)	{ p.parsePartition(file); }
 	void setClauseMap(const char* file)	{ p.parseClauseMap(file); }
 	void setYClauses(const char* file)	{ p.parseYClauses(file); }
+	// Write checkpoints to file as the search goes (-k), first resuming from
+	// the one there, if any.  The file is removed once the search is done.
+	void setCheckpoint(const char* file);
+	// Collect statistics of the search, and write them to file (-J) as a
+	// JSON object with writeStats(); timedOut is recorded in it
+	void setStatsFile(const char* file)	{ statsFile = file; profile.enable(); }
+	void writeStats(bool timedOut = false);
+	// Stop the search early (from a signal handler): with -J, the search
+	// writes the statistics and exits after its current SAT call.  Returns
+	// false (without -J) if the caller should exit itself.
+	bool interrupt()	{ if (statsFile == NULL) return false; timeUp = 1; return true; }
 
 	void setVerbose(bool b)		{ verbose = b; }
 	void setReportStats(bool b)	{ reportStats = b; }
 	void setMaxSAT(bool b)		{ maxSAT = b; }
 	void setUseCores(bool b)	{ useCores = b; }
+	void setUseCLD(bool b)		{ useCLD = b; }
+	void setStreamPCSes(bool b)	{ streamPCSes = b; }
+	void setPreprocess(bool b)	{ preprocess = b; p.setPreprocess(b); }
+	void setFindMUS(bool b)		{ findOneMUS = b; }
+	void setMUSFromCore(bool b)	{ MUSFromCore = b; }
+	void setFindNecessary(bool b)	{ detectNecessary = b; }
+	void setDecompose(bool b)	{ decompose = b; }
+	void setSelectorsFirst(SelectorPhase ph)	{ selectorsFirst = true; selectorPhase = ph; }
+	void setPruneAutarky(bool b)	{ pruneAutarky = b; p.setPruneAutarky(b); }
 
 	void setBoundInc(int i)			{ boundinc = i; initialBound = i; 
 									  if (useCores) {
@@ -179,7 +327,7 @@ public:
 		cout << "ISAT: " << numISAT << endl;
 		printStatsSet(cumulativeISATStats);
 	}
-	void printStatsSet(SolverStats& stats) {
+	void printStatsSet(const SolverStats& stats) {
 		cout << " starts       : " << stats.starts << endl;
 		cout << " conflicts    : " << stats.conflicts << endl;
 		cout << " decisions    : " << stats.decisions << endl;
@@ -0,0 +1,44 @@
+//
+//  minisatbackend.h  -  The embedded MiniSat Solver as a SAT backend.
+//
+// Copyright (C) 2009, The Regents of the University of Michigan
+// See the LICENSE file for details.
+//
+#ifndef __MINISATBACKEND_H
+#define __MINISATBACKEND_H
+
+#include "satbackend.h"
+#include "Solver.h"
+
+// The reference backend: the MiniSat Solver, extended with derivations
+// (Deriv) and AtMost constraints, is the only one to support enableDeriv().
+class MinisatBackend : public SATBackend {
+public:
+	Var newVar()		{ return s.newVar(); }
+	int nVars()			{ return s.nVars; }
+	bool addClause(const vec<Lit>& ps, unsigned int id = 0) {
+		return (ps.size() == 1) ? s.addUnit(ps[0], id) : s.addClause(ps, id);
+	}
+	bool addClause(const vec<Lit>& ps, const Bag& ids) {
+		return s.addClause(ps, ids);
+	}
+	bool addAtMost(const vec<Lit>& ps, int n)	{ return s.addAtMost(ps, n); }
+	bool okay()			{ return s.okay(); }
+
+	bool solve(const vec<Lit>& assumps)	{ return s.solve(assumps); }
+	const vec<bool>& model()	{ return s.model; }
+	const vec<Lit>& conflict()	{ return s.getConflict(); }
+
+	void enableDeriv()	{ s.enableDeriv(); }
+	void getDerivation(Bag& ids)	{ s.finalDeriv->getAncestorsSum(ids); }
+
+	void prioritize(Var v)	{ s.order.prioritize(v); }
+	void setPolarity(Var v, bool b)	{ s.polarity[v] = b; }
+
+	const SolverStats& stats()	{ return s.stats; }
+
+private:
+	Solver s;
+};
+
+#endif // __MINISATBACKEND_H
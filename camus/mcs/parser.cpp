@@ -1,6 +1,6 @@
 //
 //  parser.cpp -  Helper class for parsing various input files
-//                and filling Solver objects.
+//                and filling SAT backends.
 //
 // by Mark H. Liffiton <liffiton @ eecs . umich . edu>
 //
@@ -16,10 +16,16 @@
 using namespace std;
 
 // Read the problem into origCNF
+// A "p wcnf" formula gives each clause a weight (ignored) before its literals,
+// and clauses with a weight of at least the top weight given on the "p" line
+// (if any) are hard.
 void Parser::parseCNF(const char* source) {
 	ifstream cnfIn(source);
 	if (!cnfIn.good()) {cerr << "ERROR: Could not open file " << source << endl; exit(1);}
 
+	bool weighted = false;
+	unsigned long long top = 0;  // 0: no hard clauses
+
 	string line;
 	while (getline(cnfIn, line)) {
 
@@ -35,14 +41,20 @@ void Parser::parseCNF(const char* source) {
 
 		if (line[0] == 'p') {
 			// read the size of the CNF
-			// skip "p cnf "
-			istr.ignore(16,' ');
+			// skip "p ", get "cnf" or "wcnf"
+			string format;
 			istr.ignore(16,' ');
+			istr >> format;
+			weighted = (format == "wcnf");
 			// get values
 			istr >> CNFvars;
 			if (istr.fail()) {cerr << "ERROR: Invalid format line: " << line << endl; exit(1);}
 			istr >> CNFclauses;
 			if (istr.fail()) {cerr << "ERROR: Invalid format line: " << line << endl; exit(1);}
+			if (weighted) {
+				istr >> top;
+				if (istr.fail())  top = 0;
+			}
 			continue;
 		}
 
@@ -50,6 +62,17 @@ void Parser::parseCNF(const char* source) {
 		int parsedLit;
 		vector<Lit> newClause;
 
+		if (weighted) {
+			unsigned long long weight;
+			istr >> weight;
+			if (istr.fail()) {cerr << "ERROR: Invalid clause: " << line << endl; exit(1);}
+			if (top > 0 && weight >= top) {
+				clauseHard.resize(origCNF.size()+1);
+				clauseHard[origCNF.size()] = true;
+			}
+			istr >> std::ws;
+		}
+
 		while (!istr.eof()) {
 			istr >> parsedLit;
 			if (istr.fail()) {cerr << "ERROR: Invalid clause: " << line << endl; exit(1);}
@@ -64,8 +87,22 @@ void Parser::parseCNF(const char* source) {
 	}
 	cnfIn.close();
 
-	if (Yvars == 0) {
-		// haven't read any partition file yet, so update nYvars with one per clause
+	numHard = 0;
+	for (unsigned int i = 0 ; i < clauseHard.size() ; i++) {
+		if (clauseHard[i])  numHard++;
+	}
+
+	if (!haveGroupMap && numHard > 0) {
+		// one group per soft clause, so hard clauses take no y-var
+		for (unsigned int i = 0 ; i < origCNF.size() ; i++) {
+			clauseGroupMap.push_back(Yvars);
+			if (!isHard(i))  Yvars++;
+		}
+		haveGroupMap = true;
+	}
+
+	if (!haveGroupMap) {
+		// haven't read any partition file, so update nYvars with one per clause
 		Yvars = CNFclauses;
 	}
 }
@@ -76,10 +113,14 @@ vector<MCSBag> Parser::parseMCSes(const char* source) {
 	if (!mcsIn.good()) {cerr << "ERROR: Could not open file " << source << endl; exit(1);}
 
 	vector<MCSBag> ret;
-	unsigned size = 0;
 	string line;
 
 	while (getline(mcsIn, line)) {
+		// The last line may be incomplete if we got this from a previous run of camus_mcs
+		// that was killed; therefore, skip a last line that doesn't end in a newline.
+		// (MCSes need not be in order of size, e.g. from -c.)
+		if (mcsIn.eof())  break;
+
 		MCSBag MCS;
 		unsigned int clauseNum;
 
@@ -96,12 +137,6 @@ vector<MCSBag> Parser::parseMCSes(const char* source) {
 			istr >> std::ws; // skip whitespace (so eof is triggered if line ends with whitespace)
 		}
 
-		// The last line may be incomplete if we got this from a previous run of camus_mcs;
-		// therefore, skip anything that doesn't have enough numbers.  (Will still incorrectly
-		// read a line whose last value is truncated but that still has enough values overall.)
-		if (MCS.size() < size) break;
-
-		size = MCS.size();
 		ret.push_back(MCS);
 	}
 
@@ -112,6 +147,8 @@ vector<MCSBag> Parser::parseMCSes(const char* source) {
 // Partition should be a list of numbers, one per line, each indicating the last
 //   clause in each partition, (starting counting from 1), including the last
 //   clause of the entire formula
+// A partition given as "0 n" (ending at clause n) is hard: its clauses get no
+//   Y variable.
 void Parser::parsePartition(const char* source) {
 	ifstream partIn(source);
 	if (!partIn.good()) {cerr << "ERROR: Could not open file " << source << endl; exit(1);}
@@ -120,18 +157,23 @@ void Parser::parsePartition(const char* source) {
 
 	unsigned int split;
 
-	while (!partIn.eof()) {
-		partIn >> split;
-		if (partIn.fail() && !partIn.eof()) {cerr << "ERROR: Invalid partition in file: " << source << endl; exit(1);}
+	while (partIn >> split) {
+		bool hard = (split == 0);
+		if (hard && !(partIn >> split)) {cerr << "ERROR: Invalid partition in file: " << source << endl; exit(1);}
 
 		while (current <= split) {
 			clauseGroupMap.resize(current);
 			clauseGroupMap[current-1] = Yvars;
+			if (hard) {
+				clauseHard.resize(current);
+				clauseHard[current-1] = true;
+			}
 			//cout << "Mapping " << current << " to " << Yvars << endl;
 			current++;
 		}
-		Yvars++;
+		if (!hard)  Yvars++;
 	}
+	if (!partIn.eof()) {cerr << "ERROR: Invalid partition in file: " << source << endl; exit(1);}
 
 	haveGroupMap = true;
 }
@@ -139,6 +181,7 @@ void Parser::parsePartition(const char* source) {
 // Read a map of the clauses to setup groups of clauses for Y variables.
 // In this function, we take lists of numbers, one *list* per line, each list
 //   indicating a group by the clauses contained in it.
+// A list starting with 0 is the hard group: its clauses get no Y variable.
 void Parser::parseClauseMap(const char* source) {
 	ifstream groupIn(source);
 	if (!groupIn.good()) {cerr << "ERROR: Could not open file " << source << endl; exit(1);}
@@ -146,20 +189,35 @@ void Parser::parseClauseMap(const char* source) {
 	string line;
 	while (getline(groupIn, line)) {
 		unsigned int clauseNum;
+		bool first = true;
+		bool hard = false;
 
 		istringstream istr(line);
 
 		while (!istr.eof()) {
 			istr >> clauseNum;
 			if (istr.fail()) {cerr << "ERROR: Invalid group file line: " << line << endl; exit(1);}
+			if (clauseNum == 0 && first) {
+				hard = true;
+				first = false;
+				istr >> std::ws;
+				continue;
+			}
+			first = false;
 			if (clauseNum == 0) {cerr << "ERROR: Invalid clause index " << clauseNum << " in line: " << line << std::endl; exit(1);}
-			if (clauseNum > clauseGroupMap.size())  clauseGroupMap.resize(clauseNum);
-			clauseGroupMap[clauseNum-1] = Yvars;
+			if (hard) {
+				if (clauseNum > clauseHard.size())  clauseHard.resize(clauseNum);
+				clauseHard[clauseNum-1] = true;
+			}
+			else {
+				if (clauseNum > clauseGroupMap.size())  clauseGroupMap.resize(clauseNum);
+				clauseGroupMap[clauseNum-1] = Yvars;
+			}
 			//cout << "Mapping " << clauseNum << " to " << Yvars << endl;
 
 			istr >> std::ws; // skip whitespace (so eof is triggered if line ends with whitespace)
 		}
-		Yvars++;
+		if (!hard)  Yvars++;
 	}
 
 	haveGroupMap = true;
@@ -191,97 +249,330 @@ void Parser::parseYClauses(const char* source) {
 	}
 }
 
-// Inserts the problem into a solver from origCNF, adding Y variables.
-// Returns FALSE upon immediate conflict
-bool Parser::get_CNF_Y(Solver& sat, Bag* instrument_set) {
-	while (CNFvars+Yvars > (unsigned int)sat.nVars) sat.newVar();
+// Find the lean kernel (see autarky.h), once.  Clauses outside it are in no
+// MCS, so they can simply be left out, and their y-vars fixed TRUE.
+void Parser::findLeanKernel() {
+	if (!pruneAutarky || !clausePruned.empty())  return;  // not wanted, or already done
 
-	for (unsigned i = 0, curY = 0 ; i < origCNF.size() ; i++) {
-		vec<Lit> lits;
+	if (!origYClauses.empty()) {
+		// constraints on the y-vars could force out a clause outside the lean kernel
+		cerr << "Warning: -a can't be used with -y... ignoring -a." << endl;
+		pruneAutarky = false;
+		return;
+	}
+
+	numPruned = findMaxAutarky(CNFvars, origCNF, clausePruned);
+
+	yPruned.assign(Yvars, true);
+	for (unsigned int i = 0 ; i < origCNF.size() ; i++) {
+		if (!clausePruned[i] && !isHard(i))  yPruned[getClauseY(i)] = false;
+	}
+}
+
+// Union-find root of x, with path halving
+static unsigned int findRoot(vector<unsigned int>& parent, unsigned int x) {
+	while (parent[x] != x) {
+		parent[x] = parent[parent[x]];
+		x = parent[x];
+	}
+	return x;
+}
+
+void Parser::getComponents(vector< vector<Num> >& components, vector< vector<unsigned int> >& hard) {
+	findLeanKernel();
+
+	// one node per selector, then one per variable
+	vector<unsigned int> parent(Yvars + CNFvars);
+	for (unsigned int x = 0 ; x < parent.size() ; x++) {
+		parent[x] = x;
+	}
+
+	vector<bool> hasClauses(Yvars, false);
+	for (unsigned int i = 0 ; i < origCNF.size() ; i++) {
+		if (isPruned(i) || origCNF[i].empty())  continue;
+		// a hard clause just ties its variables together
+		unsigned int node = Yvars + var(origCNF[i][0]);
+		if (!isHard(i)) {
+			node = getClauseY(i);
+			hasClauses[node] = true;
+		}
+		for (vector<Lit>::iterator it = origCNF[i].begin() ; it != origCNF[i].end() ; it++) {
+			parent[findRoot(parent, Yvars + var(*it))] = findRoot(parent, node);
+		}
+	}
+	for (vector< vector<int> >::iterator it1 = origYClauses.begin() ; it1 != origYClauses.end() ; it1++) {
+		for (vector<int>::iterator it2 = it1->begin() ; it2 != it1->end() ; it2++) {
+			hasClauses[abs(*it2)-1] = true;
+			parent[findRoot(parent, abs(*it2)-1)] = findRoot(parent, abs((*it1)[0])-1);
+		}
+	}
+
+	components.clear();
+	hard.clear();
+	vector<int> componentOf(parent.size(), -1);  // by root
+	for (unsigned int y = 0 ; y < Yvars ; y++) {
+		if (!hasClauses[y])  continue;
+		unsigned int root = findRoot(parent, y);
+		if (componentOf[root] == -1) {
+			componentOf[root] = components.size();
+			components.push_back(vector<Num>());
+			hard.push_back(vector<unsigned int>());
+		}
+		components[componentOf[root]].push_back(y);
+	}
+
+	// hard clauses sharing no variables with any soft clause are left out
+	for (unsigned int i = 0 ; i < origCNF.size() ; i++) {
+		if (!isHard(i) || isPruned(i) || origCNF[i].empty())  continue;
+		int c = componentOf[findRoot(parent, Yvars + var(origCNF[i][0]))];
+		if (c != -1)  hard[c].push_back(i);
+	}
+}
+
+void Parser::extractComponent(const Parser& src, const vector<Num>& ys, const vector<unsigned int>& hard) {
+	vector<int> newY(src.Yvars, -1);
+	for (unsigned int k = 0 ; k < ys.size() ; k++) {
+		newY[ys[k]] = k;
+	}
+	vector<int> newVar(src.CNFvars, -1);
+	vector<bool> takeHard(src.origCNF.size(), false);
+	for (unsigned int j = 0 ; j < hard.size() ; j++) {
+		takeHard[hard[j]] = true;
+	}
+
+	for (unsigned int i = 0 ; i < src.origCNF.size() ; i++) {
+		if (src.isHard(i)) {
+			if (!takeHard[i])  continue;
+			clauseHard.resize(origCNF.size()+1);
+			clauseHard[origCNF.size()] = true;
+			numHard++;
+		}
+		else if (src.isPruned(i) || newY[src.getClauseY(i)] == -1)  continue;
+
+		vector<Lit> clause;
+		for (vector<Lit>::const_iterator it = src.origCNF[i].begin() ; it != src.origCNF[i].end() ; it++) {
+			if (newVar[var(*it)] == -1)  newVar[var(*it)] = CNFvars++;
+			clause.push_back(Lit(newVar[var(*it)], sign(*it)));
+		}
+		clauseGroupMap.push_back(src.isHard(i) ? 0 : newY[src.getClauseY(i)]);
+		origCNF.push_back(clause);
+	}
+	CNFclauses = origCNF.size();
+	Yvars = ys.size();
+	haveGroupMap = true;
+
+	for (vector< vector<int> >::const_iterator it1 = src.origYClauses.begin() ; it1 != src.origYClauses.end() ; it1++) {
+		if (it1->empty() || newY[abs((*it1)[0])-1] == -1)  continue;  // another component's
+		vector<int> clause;
+		for (vector<int>::const_iterator it2 = it1->begin() ; it2 != it1->end() ; it2++) {
+			int y = newY[abs(*it2)-1] + 1;
+			clause.push_back(*it2 > 0 ? y : -y);
+		}
+		origYClauses.push_back(clause);
+	}
+
+	preprocess = src.preprocess;
+}
+
+// Simplify the fully instrumented CNF (every clause with its y-var), freezing
+// the y-vars so the result is equisatisfiable under any assignment to them.
+// Every clause derived this way keeps the y-literals of all of the original
+// clauses it came from, so get_CNF_Y() can still give each one the right
+// derivation when some of those y-vars are not in play.
+void Parser::preprocessCNF_Y() {
+	if (pre != NULL)  return;  // already done
+
+	findLeanKernel();
+
+	pre = new Preprocessor(CNFvars+Yvars);
+	for (unsigned int y = 0 ; y < Yvars ; y++) {
+		pre->freeze(CNFvars+y);
+	}
 
-		// calculate our current Y-var index
+	preprocessedOK = true;
+	for (unsigned i = 0, curY = 0 ; preprocessedOK && i < origCNF.size() ; i++) {
 		if (haveGroupMap) {
 			curY = clauseGroupMap[i];
 		}
 
-		// add the given clause to the growing clause
-		for (vector<Lit>::iterator it2 = origCNF[i].begin() ; it2 != origCNF[i].end() ; it2++) {
-			lits.push(*it2);
-
-			// This creates (clauselit_i -> Y_i) clauses
-			// Seems to just slow things down - guess MiniSAT is pretty clever on its own
-			// Tested on April 4, 2007 w/ c14.cnf, c15.cnf, c19.cnf, including -x 3,30,etc.
-			// All slower w/ helper implications.
-			/*
-			vec<Lit> helperImplication;
-			helperImplication.push(~*it2);
-			helperImplication.push(Lit(CNFvars + curY));
-			if (!sat.addClause(helperImplication))
-				return false;
-			*/
+		if (!isPruned(i)) {
+			vector<Lit> lits(origCNF[i]);
+			if (!isHard(i))  lits.push_back(~Lit(CNFvars+curY));
+			preprocessedOK = pre->addClause(lits);
 		}
 
+		if (!haveGroupMap)
+			curY++;
+	}
 
-		if (instrument_set == NULL || instrument_set->find(curY+1) != instrument_set->end()) {
-			// If we're not provided with a set of clauses to instrument, or if
-			// the current y-var isn't included in that set, just make the clause and add it.
+	if (preprocessedOK)  preprocessedOK = pre->simplify();
+	if (preprocessedOK)  pre->getClauses(preprocessedCNF_Y);
+}
 
-			// insert y-var
-			// putting it at the end of the clause makes things a smidge faster
-			//  - My guess: it's because the massive AtMost propagations hit fewer watches
-			lits.push(~Lit(CNFvars+curY));
+// Inserts the problem into a solver from origCNF, adding Y variables for the
+// selectors in play in ymap.
+// Returns FALSE upon immediate conflict
+bool Parser::get_CNF_Y(SATBackend& sat, const SelectorMap& ymap) {
+	while (ymap.nVars() > (unsigned int)sat.nVars()) sat.newVar();
 
-			// don't need to find ancestors with this
-			// (by supplying the second parameter of addClause),
-			// because it will always be included from now on
-			if (!sat.addClause(lits))
+	findLeanKernel();
+	for (unsigned int y = 0 ; y < yPruned.size() ; y++) {
+		if (yPruned[y] && ymap.inPlay(y)) {
+			if (!sat.addUnit(ymap.lit(y)))
 				return false;
 		}
-		else {
-			// If we do have a set ot instrument and this y-var is in it:
+	}
 
-			// "Tie down" any "loose" variables, those y-vars that are not used anywhere
-			// This is surprisingly important to avoid MiniSAT flipping out and making
-			// all kinds of decisions on the unused variables.
-			sat.addUnit(Lit(CNFvars+curY));
-			// Yes, it would be more efficient/elegant/nice/etc. to only create variables
-			// we need.  But then I would have to go mess around with all the y-variable-
-			// handling code, adding some sort of map between y-variable and clause index, etc.
+	if (preprocess) {
+		preprocessCNF_Y();
+		if (!preprocessedOK)
+			return false;
 
-			if (lits.size() == 1) {
-				if (!sat.addUnit(lits[0], curY+1))
+		// Tie down eliminated variables; any value will do, as
+		// extendModel() will fix them up if a full model is ever needed.
+		for (unsigned int v = 0 ; v < CNFvars ; v++) {
+			if (pre->isEliminated(v))  sat.addUnit(~Lit(v));
+		}
+
+		for (vector< vector<Lit> >::iterator it1 = preprocessedCNF_Y.begin() ; it1 != preprocessedCNF_Y.end() ; it1++) {
+			vec<Lit> lits;
+			Bag ids;	// selectors not in play (TRUE) whose literals are dropped
+			bool satisfied = false;
+			for (vector<Lit>::iterator it2 = it1->begin() ; it2 != it1->end() ; it2++) {
+				if ((unsigned)var(*it2) < CNFvars) {
+					lits.push(*it2);
+					continue;
+				}
+				Num y = var(*it2) - CNFvars;
+				if (ymap.inPlay(y)) {
+					lits.push(sign(*it2) ? ~ymap.lit(y) : ymap.lit(y));
+				}
+				else if (sign(*it2)) {
+					ids.insert(y+1);
+				}
+				else {
+					satisfied = true;
+				}
+			}
+			if (satisfied)  continue;
+
+			if (!ids.empty()) {
+				if (!sat.addClause(lits, ids))
+					return false;
+			}
+			else if (lits.size() == 1) {
+				if (!sat.addUnit(lits[0]))
 					return false;
 			}
 			else {
-				if (!sat.addClause(lits, curY+1))
+				if (!sat.addClause(lits))
 					return false;
 			}
 		}
+	}
+	else {
+		for (unsigned i = 0, curY = 0 ; i < origCNF.size() ; i++) {
+			vec<Lit> lits;
 
-		if (!haveGroupMap)
-			curY++;
+			// calculate our current Y-var index
+			if (haveGroupMap) {
+				curY = clauseGroupMap[i];
+			}
+
+			if (isPruned(i)) {
+				if (!haveGroupMap)
+					curY++;
+				continue;
+			}
+
+			// add the given clause to the growing clause
+			for (vector<Lit>::iterator it2 = origCNF[i].begin() ; it2 != origCNF[i].end() ; it2++) {
+				lits.push(*it2);
+
+				// This creates (clauselit_i -> Y_i) clauses
+				// Seems to just slow things down - guess MiniSAT is pretty clever on its own
+				// Tested on April 4, 2007 w/ c14.cnf, c15.cnf, c19.cnf, including -x 3,30,etc.
+				// All slower w/ helper implications.
+				/*
+				vec<Lit> helperImplication;
+				helperImplication.push(~*it2);
+				helperImplication.push(Lit(CNFvars + curY));
+				if (!sat.addClause(helperImplication))
+					return false;
+				*/
+			}
+
+
+			if (isHard(i)) {
+				// no y-var, and always included
+				if (lits.size() == 1) {
+					if (!sat.addUnit(lits[0]))
+						return false;
+				}
+				else {
+					if (!sat.addClause(lits))
+						return false;
+				}
+			}
+			else if (ymap.inPlay(curY)) {
+				// insert y-var
+				// putting it at the end of the clause makes things a smidge faster
+				//  - My guess: it's because the massive AtMost propagations hit fewer watches
+				lits.push(~ymap.lit(curY));
+
+				// don't need to find ancestors with this
+				// (by supplying the second parameter of addClause),
+				// because it will always be included from now on
+				if (!sat.addClause(lits))
+					return false;
+			}
+			else {
+				// The y-var isn't in play, so the clause is simply enabled.
+				// (This used to "tie down" a y-var for every such clause with
+				// a unit clause, so MiniSAT wouldn't make decisions on unused
+				// variables; now those variables just don't exist.)
+
+				if (lits.size() == 1) {
+					if (!sat.addUnit(lits[0], curY+1))
+						return false;
+				}
+				else {
+					if (!sat.addClause(lits, curY+1))
+						return false;
+				}
+			}
+
+			if (!haveGroupMap)
+				curY++;
+		}
 	}
 
 	// add the y var clauses, if there are any
 	for (vector< vector<int> >::iterator it1 = origYClauses.begin() ; it1 != origYClauses.end() ; it1++) {
 		vec<Lit> lits;
+		Bag ids;	// selectors not in play (TRUE) whose literals are dropped
+		bool satisfied = false;
 
 		for (vector<int>::iterator it2 = it1->begin() ; it2 != it1->end() ; it2++) {
-			int var = CNFvars + abs(*it2)-1;
-			lits.push( (*it2 > 0) ? Lit(var) : ~Lit(var) );
+			Num y = abs(*it2)-1;
+			if (ymap.inPlay(y))  lits.push( (*it2 > 0) ? ymap.lit(y) : ~ymap.lit(y) );
+			else if (*it2 < 0)  ids.insert(y+1);
+			else  satisfied = true;
 		}
-		if (!sat.addClause(lits))
+		if (satisfied)  continue;
+		if (!(ids.empty() ? sat.addClause(lits) : sat.addClause(lits, ids)))
 			return false;
 	}
 
-	sat.simplifyDB();
 	return sat.okay();
 }
 
 // Inserts the problem into a solver from origCNF, without adding Y variables.
 // Returns FALSE upon immediate conflict
-bool Parser::get_CNF(Solver& sat, Bag* exclude, int way) {
-	while (CNFvars > (unsigned int)sat.nVars) sat.newVar();
+bool Parser::get_CNF(SATBackend& sat, Bag* exclude, int way) {
+	while (CNFvars > (unsigned int)sat.nVars()) sat.newVar();
+
+	findLeanKernel();
 
 	unsigned curY = (way) ? origCNF.size()-1 : 0;
 	for (int i = (way) ? (int)origCNF.size()-1 : 0 ; (way) ? i >= 0 : (i < (int)origCNF.size()) ; (way) ? i-- : i++ ) {
@@ -296,7 +587,21 @@ bool Parser::get_CNF(Solver& sat, Bag* exclude, int way) {
 			lits.push(*it2);
 		}
 
-		if (exclude == NULL || exclude->find(curY+1) == exclude->end()) {
+		if (isPruned(i)) {
+			// left out
+		}
+		else if (isHard(i)) {
+			// never excluded, and not part of any derivation
+			if (lits.size() == 1) {
+				if (!sat.addUnit(lits[0]))
+					return false;
+			}
+			else {
+				if (!sat.addClause(lits))
+					return false;
+			}
+		}
+		else if (exclude == NULL || exclude->find(curY+1) == exclude->end()) {
 			if (lits.size() == 1) {
 				if (!sat.addUnit(lits[0], curY+1))
 					return false;
@@ -311,7 +616,6 @@ bool Parser::get_CNF(Solver& sat, Bag* exclude, int way) {
 			(way) ? curY-- : curY++;
 	}
 
-	sat.simplifyDB();
 	return sat.okay();
 }
 
@@ -1,6 +1,6 @@
 //
 //  parser.h  -  Helper class for parsing various input files
-//               and filling Solver objects.
+//               and filling SAT backends.
 //
 // by Mark H. Liffiton <liffiton @ eecs . umich . edu>
 //
@@ -10,8 +10,11 @@
 #ifndef __PARSER_H
 #define __PARSER_H
 
-#include "Solver.h"
+#include "satbackend.h"
 #include "defs.h"
+#include "preprocessor.h"
+#include "autarky.h"
+#include "selectormap.h"
 #include <iostream>
 #include <vector>
 #include <set>
@@ -22,6 +25,14 @@ public:
 	Parser() {
 		CNFvars = CNFclauses = Yvars = 0;
 		haveGroupMap = false;
+		preprocess = false;
+		pre = NULL;
+		pruneAutarky = false;
+		numPruned = 0;
+		numHard = 0;
+	}
+	~Parser() {
+		delete pre;
 	}
 
 	void parseCNF(const char* source);
@@ -29,10 +40,56 @@ public:
 	void parsePartition(const char* source);
 	void parseClauseMap(const char* source);
 	void parseYClauses(const char* source);
-	bool get_CNF_Y(Solver& sat, Bag* anc = NULL);
-	bool get_CNF(Solver& sat, Bag* exclude = NULL, int way = 0);
+	bool get_CNF_Y(SATBackend& sat, const SelectorMap& ymap);
+	bool get_CNF(SATBackend& sat, Bag* exclude = NULL, int way = 0);
+
+	// Simplify the instrumented CNF once (y-vars frozen) and have get_CNF_Y()
+	// load the simplified clauses from then on.
+	void setPreprocess(bool b) { preprocess = b; }
+	void preprocessCNF_Y();
+	const Preprocessor* getPreprocessor() { return pre; }
+	// Drop the clauses satisfied by the largest autarky (they are in no MUS
+	// or MCS) from every Solver filled from here on; a selector whose clauses
+	// are all dropped is fixed TRUE.
+	void setPruneAutarky(bool b) { pruneAutarky = b; }
+	void findLeanKernel();
+	unsigned int getNumPruned() { return numPruned; }
+	inline bool isPruned(unsigned int i) const {
+		return !clausePruned.empty() && clausePruned[i];
+	}
+	inline bool isPrunedY(unsigned int y) const {
+		return !yPruned.empty() && yPruned[y];
+	}
+	// Split the selectors into components: sets of selectors whose clauses
+	// (and y-clauses) share no variables with those of any other set, even
+	// through hard clauses (listed in hard, per component).
+	// Selectors with no clauses left (see findLeanKernel()) are in none.
+	void getComponents(vector< vector<Num> >& components, vector< vector<unsigned int> >& hard);
+	// Fill this (new) Parser with just the clauses of selectors ys of src
+	// and the hard clauses hard, renumbering the variables, and the selectors
+	// so that selector k here is ys[k] in src.
+	void extractComponent(const Parser& src, const vector<Num>& ys, const vector<unsigned int>& hard);
+	// Fill in values for variables removed by preprocessing in a model from a
+	// Solver filled by get_CNF_Y()
+	// (numbered as when preprocessed: the CNF variables, then every selector)
+	void extendModel(vec<bool>& model) {
+		if (pre != NULL)  pre->extendModel(model);
+	}
+	bool isPreprocessed() const { return pre != NULL; }
 
 	void get_clause(unsigned int i, vector<Lit>& clause);
+	// Hard clauses (0-based) have no y-var: they are always included
+	inline bool isHard(unsigned int i) const {
+		return i < clauseHard.size() && clauseHard[i];
+	}
+	unsigned int getNumHard() { return numHard; }
+	// The y-var (0-based) that selects clause i (0-based), if it isn't hard
+	inline unsigned int getClauseY(unsigned int i) const {
+		return haveGroupMap ? clauseGroupMap[i] : i;
+	}
+	inline bool hasYClauses() {
+		return !origYClauses.empty();
+	}
 
 	unsigned int getCNFvars() {return CNFvars;}
 	unsigned int getCNFclauses() {return CNFclauses;}
@@ -61,6 +118,18 @@ private:
 	std::vector<unsigned int> clauseGroupMap;
 	std::vector< vector<Lit> > origCNF;
 	std::vector< vector<int> > origYClauses;
+	std::vector<bool> clauseHard;	// clause i is hard (may be shorter than origCNF)
+	unsigned int numHard;
+
+	bool preprocess;
+	Preprocessor* pre;
+	bool preprocessedOK;
+	std::vector< vector<Lit> > preprocessedCNF_Y;	// instrumented clauses only (not origYClauses)
+
+	bool pruneAutarky;
+	unsigned int numPruned;
+	std::vector<bool> clausePruned;	// clause i is outside the lean kernel (empty if not computed)
+	std::vector<bool> yPruned;		// all of y's clauses are
 
 };
 
@@ -0,0 +1,423 @@
+//
+//  preprocessor.cpp  -  SatELite-style CNF simplification with frozen variables.
+//
+// Copyright (C) 2009, The Regents of the University of Michigan
+// See the LICENSE file for details.
+//
+
+#include "preprocessor.h"
+#include <algorithm>
+
+Preprocessor::Preprocessor(unsigned int numVars) :
+	numEliminated(0),
+	numSubsumed(0),
+	numStrengthened(0),
+	numFailed(0),
+	nVars(numVars),
+	ok(true),
+	occurs(2*numVars),
+	assigns(numVars, 0),
+	frozen(numVars, 0),
+	eliminated(numVars, 0)
+{ }
+
+uint64_t Preprocessor::signature(const vector<Lit>& lits) {
+	uint64_t sig = 0;
+	for (vector<Lit>::const_iterator it = lits.begin() ; it != lits.end() ; it++) {
+		sig |= (uint64_t)1 << (var(*it) & 63);
+	}
+	return sig;
+}
+
+bool Preprocessor::enqueue(Lit p) {
+	if (value(p) == 1)  return true;
+	if (value(p) == -1)  return (ok = false);
+	assigns[var(p)] = sign(p) ? -1 : 1;
+	propQ.push_back(p);
+	return true;
+}
+
+// Remove satisfied clauses and false literals for everything in propQ
+bool Preprocessor::propagateUnits() {
+	while (ok && !propQ.empty()) {
+		Lit p = propQ.back();
+		propQ.pop_back();
+
+		vector<unsigned int>& sat = occurs[index(p)];
+		for (unsigned int i = 0 ; i < sat.size() ; i++) {
+			if (!clauses[sat[i]].removed)  removeClause(sat[i]);
+		}
+		sat.clear();
+
+		vector<unsigned int> shrink;
+		shrink.swap(occurs[index(~p)]);
+		for (unsigned int i = 0 ; ok && i < shrink.size() ; i++) {
+			if (!clauses[shrink[i]].removed)  strengthen(shrink[i], ~p);
+		}
+	}
+	return ok;
+}
+
+// Store a normalized clause (sorted, no duplicates/tautologies/assigned literals, size >= 2)
+unsigned int Preprocessor::storeClause(vector<Lit>& lits) {
+	unsigned int ci = clauses.size();
+	clauses.push_back(PClause());
+	PClause& c = clauses.back();
+	c.lits.swap(lits);
+	c.sig = signature(c.lits);
+	c.removed = false;
+	for (vector<Lit>::iterator it = c.lits.begin() ; it != c.lits.end() ; it++) {
+		occurs[index(*it)].push_back(ci);
+	}
+	queueSubsume(ci);
+	return ci;
+}
+
+bool Preprocessor::addClause(const vector<Lit>& input) {
+	if (!ok)  return false;
+
+	vector<Lit> lits(input);
+	std::sort(lits.begin(), lits.end());
+
+	unsigned int j = 0;
+	for (unsigned int i = 0 ; i < lits.size() ; i++) {
+		if (value(lits[i]) == 1)  return true;		// satisfied
+		if (value(lits[i]) == -1)  continue;		// false literal
+		if (j > 0 && lits[i] == lits[j-1])  continue;	// duplicate
+		if (j > 0 && lits[i] == ~lits[j-1])  return true;	// tautology (p and ~p are adjacent when sorted)
+		lits[j++] = lits[i];
+	}
+	lits.resize(j);
+
+	if (lits.empty())  return (ok = false);
+	if (lits.size() == 1)  return enqueue(lits[0]);
+
+	storeClause(lits);
+	return true;
+}
+
+void Preprocessor::removeClause(unsigned int ci) {
+	// occurrence lists are cleaned lazily
+	clauses[ci].removed = true;
+}
+
+// Remove literal l from clause ci
+bool Preprocessor::strengthen(unsigned int ci, Lit l) {
+	PClause& c = clauses[ci];
+	c.lits.erase(std::find(c.lits.begin(), c.lits.end(), l));
+	c.sig = signature(c.lits);
+
+	vector<unsigned int>& os = occurs[index(l)];
+	vector<unsigned int>::iterator it = std::find(os.begin(), os.end(), ci);
+	if (it != os.end()) {
+		*it = os.back();
+		os.pop_back();
+	}
+
+	if (c.lits.size() == 1) {
+		Lit unit = c.lits[0];
+		removeClause(ci);
+		return enqueue(unit);
+	}
+
+	queueSubsume(ci);
+	return true;
+}
+
+void Preprocessor::cleanOccurs(Lit p) {
+	vector<unsigned int>& os = occurs[index(p)];
+	unsigned int j = 0;
+	for (unsigned int i = 0 ; i < os.size() ; i++) {
+		if (!clauses[os[i]].removed)  os[j++] = os[i];
+	}
+	os.resize(j);
+}
+
+void Preprocessor::queueSubsume(unsigned int ci) {
+	if (ci >= inSubsumeQ.size())  inSubsumeQ.resize(ci+1, 0);
+	if (inSubsumeQ[ci])  return;
+	inSubsumeQ[ci] = 1;
+	subsumeQ.push_back(ci);
+}
+
+// Both clauses are sorted by literal index, and therefore by variable.
+Lit Preprocessor::subsumes(const vector<Lit>& d, const vector<Lit>& c, int64_t& budget) const {
+	Lit flip = lit_Undef;
+	unsigned int j = 0;
+	budget -= c.size();
+	for (unsigned int i = 0 ; i < d.size() ; i++) {
+		while (j < c.size() && var(c[j]) < var(d[i]))  j++;
+		if (j == c.size() || var(c[j]) != var(d[i]))  return lit_Error;
+		if (c[j] != d[i]) {
+			if (flip != lit_Undef)  return lit_Error;
+			flip = d[i];
+		}
+		j++;
+	}
+	return flip;
+}
+
+bool Preprocessor::backwardSubsume(int64_t& budget) {
+	while (ok && !subsumeQ.empty() && budget > 0) {
+		unsigned int ci = subsumeQ.back();
+		subsumeQ.pop_back();
+		inSubsumeQ[ci] = 0;
+		if (clauses[ci].removed)  continue;
+
+		const vector<Lit> d = clauses[ci].lits;
+		const uint64_t dsig = clauses[ci].sig;
+
+		// any clause subsumed or strengthened by d contains d's
+		// least-occurring variable (in one polarity or the other)
+		Lit best = d[0];
+		for (unsigned int i = 1 ; i < d.size() ; i++) {
+			if (occurs[index(d[i])].size() + occurs[index(~d[i])].size()
+					< occurs[index(best)].size() + occurs[index(~best)].size()) {
+				best = d[i];
+			}
+		}
+
+		for (int polarity = 0 ; ok && polarity < 2 ; polarity++) {
+			const vector<unsigned int> cands = occurs[index(polarity ? ~best : best)];
+			for (unsigned int k = 0 ; ok && k < cands.size() ; k++) {
+				unsigned int cj = cands[k];
+				if (cj == ci || clauses[cj].removed)  continue;
+				const PClause& c = clauses[cj];
+				if (c.lits.size() < d.size() || (dsig & ~c.sig) != 0)  continue;
+
+				Lit r = subsumes(d, c.lits, budget);
+				if (r == lit_Undef) {
+					removeClause(cj);
+					numSubsumed++;
+				}
+				else if (r != lit_Error) {
+					// self-subsuming resolution: drop ~r from c
+					numStrengthened++;
+					strengthen(cj, ~r);
+				}
+			}
+		}
+
+		propagateUnits();
+	}
+	return ok;
+}
+
+// Resolve pos (containing v) and neg (containing ~v) on v.
+// Returns FALSE if the resolvent is a tautology.
+bool Preprocessor::resolve(const vector<Lit>& pos, const vector<Lit>& neg, Var v, vector<Lit>& out) const {
+	out.clear();
+	unsigned int i = 0, j = 0;
+	while (i < pos.size() || j < neg.size()) {
+		Lit next;
+		if (j == neg.size() || (i < pos.size() && pos[i] < neg[j]))  next = pos[i++];
+		else  next = neg[j++];
+
+		if (var(next) == v)  continue;
+		if (!out.empty() && var(out.back()) == var(next)) {
+			if (out.back() != next)  return false;  // tautology
+			continue;  // duplicate
+		}
+		out.push_back(next);
+	}
+	return true;
+}
+
+bool Preprocessor::eliminateVar(Var v) {
+	Lit p = Lit(v);
+	cleanOccurs(p);
+	cleanOccurs(~p);
+	const vector<unsigned int> pos = occurs[index(p)];
+	const vector<unsigned int> neg = occurs[index(~p)];
+
+	if (pos.empty() && neg.empty())  return true;  // unused
+	if (!pos.empty() && !neg.empty() && (pos.size() > maxOccurrences || neg.size() > maxOccurrences))  return true;
+
+	// Only eliminate if the resolvents are no more numerous than the clauses they replace
+	vector< vector<Lit> > resolvents;
+	vector<Lit> res;
+	for (unsigned int i = 0 ; i < pos.size() ; i++) {
+		for (unsigned int j = 0 ; j < neg.size() ; j++) {
+			if (resolve(clauses[pos[i]].lits, clauses[neg[j]].lits, v, res)) {
+				if (resolvents.size() + 1 > pos.size() + neg.size())  return true;
+				if (res.size() > maxResolventLength)  return true;
+				resolvents.push_back(res);
+			}
+		}
+	}
+
+	// Save the eliminated clauses (pivot literal first) for extendModel()
+	for (int polarity = 0 ; polarity < 2 ; polarity++) {
+		const vector<unsigned int>& cs = polarity ? neg : pos;
+		Lit pivot = polarity ? ~p : p;
+		for (unsigned int i = 0 ; i < cs.size() ; i++) {
+			const vector<Lit>& lits = clauses[cs[i]].lits;
+			elimStack.push_back(index(pivot));
+			for (unsigned int k = 0 ; k < lits.size() ; k++) {
+				if (lits[k] != pivot)  elimStack.push_back(index(lits[k]));
+			}
+			elimStack.push_back(lits.size());
+			removeClause(cs[i]);
+		}
+	}
+	occurs[index(p)].clear();
+	occurs[index(~p)].clear();
+
+	eliminated[v] = 1;
+	numEliminated++;
+
+	for (unsigned int i = 0 ; ok && i < resolvents.size() ; i++) {
+		addClause(resolvents[i]);
+	}
+	return propagateUnits();
+}
+
+struct elimOrder_lt {
+	const vector<uint64_t>& cost;
+	elimOrder_lt(const vector<uint64_t>& c) : cost(c) {}
+	bool operator () (Var x, Var y) const { return cost[x] < cost[y]; }
+};
+
+bool Preprocessor::eliminateVars() {
+	// cheapest candidates (fewest potential resolvents) first
+	vector<uint64_t> cost(nVars, 0);
+	vector<Var> cands;
+	for (Var v = 0 ; v < (Var)nVars ; v++) {
+		if (frozen[v] || eliminated[v] || assigns[v] != 0)  continue;
+		cleanOccurs(Lit(v));
+		cleanOccurs(~Lit(v));
+		cost[v] = (uint64_t)occurs[index(Lit(v))].size() * occurs[index(~Lit(v))].size();
+		cands.push_back(v);
+	}
+	std::sort(cands.begin(), cands.end(), elimOrder_lt(cost));
+
+	int64_t budget = subsumeBudget;
+	for (unsigned int i = 0 ; ok && i < cands.size() ; i++) {
+		Var v = cands[i];
+		if (eliminated[v] || assigns[v] != 0)  continue;
+		if (!eliminateVar(v))  break;
+		// resolvents may subsume or strengthen existing clauses
+		backwardSubsume(budget);
+	}
+	return ok;
+}
+
+// Failed-literal probing (with lifting: literals implied by both v and ~v are units)
+bool Preprocessor::probe() {
+	vector<signed char> probeVal(nVars, 0);
+	vector<char> impliedByPos(2*nVars, 0);
+	vector<Lit> trail, posTrail;
+	int64_t budget = probeBudget;
+
+	for (Var v = 0 ; ok && v < (Var)nVars && budget > 0 ; v++) {
+		if (frozen[v] || eliminated[v] || assigns[v] != 0)  continue;
+		if (occurs[index(Lit(v))].empty() || occurs[index(~Lit(v))].empty())  continue;
+
+		vector<Lit> units;
+		for (int polarity = 0 ; polarity < 2 ; polarity++) {
+			Lit p = polarity ? ~Lit(v) : Lit(v);
+			bool conflict = false;
+
+			trail.clear();
+			trail.push_back(p);
+			probeVal[v] = sign(p) ? -1 : 1;
+			for (unsigned int t = 0 ; !conflict && t < trail.size() ; t++) {
+				const vector<unsigned int>& os = occurs[index(~trail[t])];
+				for (unsigned int k = 0 ; !conflict && k < os.size() ; k++) {
+					const PClause& c = clauses[os[k]];
+					if (c.removed)  continue;
+					budget -= c.lits.size();
+
+					Lit unassigned = lit_Undef;
+					unsigned int numUnassigned = 0;
+					bool satisfied = false;
+					for (unsigned int i = 0 ; i < c.lits.size() && !satisfied ; i++) {
+						Lit l = c.lits[i];
+						int val = value(l);
+						if (val == 0) {
+							val = probeVal[var(l)];
+							if (sign(l))  val = -val;
+						}
+						if (val == 1)  satisfied = true;
+						else if (val == 0)  unassigned = l, numUnassigned++;
+					}
+					if (satisfied || numUnassigned > 1)  continue;
+					if (numUnassigned == 0) {
+						conflict = true;
+					}
+					else {
+						probeVal[var(unassigned)] = sign(unassigned) ? -1 : 1;
+						trail.push_back(unassigned);
+					}
+				}
+			}
+
+			for (unsigned int t = 0 ; t < trail.size() ; t++) {
+				probeVal[var(trail[t])] = 0;
+			}
+
+			if (conflict) {
+				numFailed++;
+				units.clear();
+				units.push_back(~p);
+				break;
+			}
+			for (unsigned int t = 1 ; t < trail.size() ; t++) {
+				if (polarity == 0)  impliedByPos[index(trail[t])] = 1;
+				else if (impliedByPos[index(trail[t])])  units.push_back(trail[t]);
+			}
+			if (polarity == 0)  posTrail = trail;
+		}
+		for (unsigned int t = 1 ; t < posTrail.size() ; t++) {
+			impliedByPos[index(posTrail[t])] = 0;
+		}
+		posTrail.clear();
+
+		for (unsigned int i = 0 ; ok && i < units.size() ; i++) {
+			enqueue(units[i]);
+		}
+		propagateUnits();
+	}
+	return ok;
+}
+
+bool Preprocessor::simplify() {
+	int64_t budget = subsumeBudget;
+	if (ok)  propagateUnits();
+	if (ok)  backwardSubsume(budget);
+	if (ok)  eliminateVars();
+	if (ok)  probe();
+	budget = subsumeBudget;
+	if (ok)  backwardSubsume(budget);
+	return ok;
+}
+
+void Preprocessor::getClauses(vector< vector<Lit> >& out) const {
+	out.clear();
+	for (unsigned int i = 0 ; i < clauses.size() ; i++) {
+		if (!clauses[i].removed)  out.push_back(clauses[i].lits);
+	}
+	for (Var v = 0 ; v < (Var)nVars ; v++) {
+		if (assigns[v] != 0)  out.push_back(vector<Lit>(1, Lit(v, assigns[v] < 0)));
+	}
+}
+
+void Preprocessor::extendModel(vec<bool>& model) const {
+	int i = elimStack.size();
+	while (i > 0) {
+		int size = elimStack[i-1];
+		int first = i-1-size;
+
+		bool satisfied = false;
+		for (int k = first ; k < i-1 && !satisfied ; k++) {
+			Lit l = Lit(elimStack[k] >> 1, elimStack[k] & 1);
+			satisfied = (model[var(l)] != sign(l));
+		}
+		if (!satisfied) {
+			Lit pivot = Lit(elimStack[first] >> 1, elimStack[first] & 1);
+			model[var(pivot)] = !sign(pivot);
+		}
+
+		i = first;
+	}
+}
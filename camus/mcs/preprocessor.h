@@ -0,0 +1,107 @@
+//
+//  preprocessor.h  -  SatELite-style CNF simplification with frozen variables.
+//
+// Copyright (C) 2009, The Regents of the University of Michigan
+// See the LICENSE file for details.
+//
+#ifndef __PREPROCESSOR_H
+#define __PREPROCESSOR_H
+
+#include "SolverTypes.h"
+#include <vector>
+#include <stdint.h>
+
+using std::vector;
+
+// Simplifies a clause set before it is loaded into any Solver, using
+//  - top-level unit propagation,
+//  - (backward) subsumption and self-subsuming resolution,
+//  - bounded variable elimination (eliminate v if replacing its clauses by
+//    their non-tautological resolvents does not increase the clause count),
+//  - failed-literal probing.
+//
+// Frozen variables (the y-variables in camus_mcs) are never eliminated or
+// probed, so the result is equisatisfiable with the input under *every*
+// assignment to the frozen variables.  That is exactly what MCS enumeration
+// needs, since the search is entirely in terms of the y-variables.
+class Preprocessor {
+public:
+	Preprocessor(unsigned int numVars);
+
+	void freeze(Var v)	{ frozen[v] = 1; }
+
+	// Returns FALSE if the clause set is now known to be unsatisfiable.
+	bool addClause(const vector<Lit>& lits);
+
+	// Run all simplifications.  Returns FALSE if the clause set is unsatisfiable.
+	bool simplify();
+
+	// The simplified clause set, including unit clauses for all assigned variables.
+	void getClauses(vector< vector<Lit> >& out) const;
+
+	bool isEliminated(Var v) const	{ return eliminated[v]; }
+
+	// Assign the eliminated variables in a model of the simplified clause set
+	// so that it becomes a model of the original clause set.
+	void extendModel(vec<bool>& model) const;
+
+	unsigned int numEliminated;
+	unsigned int numSubsumed;
+	unsigned int numStrengthened;
+	unsigned int numFailed;
+
+private:
+	struct PClause {
+		vector<Lit> lits;	// sorted
+		uint64_t sig;		// one bit per variable (mod 64), so it matches either polarity
+		bool removed;
+	};
+
+	unsigned int nVars;
+	bool ok;
+	vector<PClause> clauses;
+	vector< vector<unsigned int> > occurs;	// index(lit) -> clauses containing lit (may hold removed clauses)
+	vector<signed char> assigns;			// per variable: 1 true, -1 false, 0 unassigned
+	vector<char> frozen;
+	vector<char> eliminated;
+	vector<Lit> propQ;
+	vector<unsigned int> subsumeQ;			// clauses to try as subsumers/strengtheners
+	vector<char> inSubsumeQ;
+
+	// Eliminated clauses for extendModel(): each stored as its literals with
+	// the eliminated variable's literal first, followed by the clause size.
+	vector<int> elimStack;
+
+	// Effort limits
+	static const unsigned int maxResolventLength = 20;
+	static const unsigned int maxOccurrences = 16;	// per polarity, for elimination candidates
+	static const int64_t probeBudget = 10000000;	// literal visits
+	static const int64_t subsumeBudget = 50000000;	// literal comparisons
+
+	inline int value(Lit p) const {
+		int v = assigns[var(p)];
+		return sign(p) ? -v : v;
+	}
+	static uint64_t signature(const vector<Lit>& lits);
+
+	bool enqueue(Lit p);
+	bool propagateUnits();
+	unsigned int storeClause(vector<Lit>& lits);
+	void removeClause(unsigned int ci);
+	bool strengthen(unsigned int ci, Lit l);
+	void cleanOccurs(Lit p);
+	void queueSubsume(unsigned int ci);
+
+	// lit_Error: no relation; lit_Undef: d subsumes c; otherwise the literal
+	// l in d such that ~l in c and the rest of d is contained in c
+	Lit subsumes(const vector<Lit>& d, const vector<Lit>& c, int64_t& budget) const;
+	bool backwardSubsume(int64_t& budget);
+
+	bool resolve(const vector<Lit>& pos, const vector<Lit>& neg, Var v, vector<Lit>& out) const;
+	bool eliminateVar(Var v);
+	bool eliminateVars();
+
+	bool probe();
+};
+
+#endif // __PREPROCESSOR_H
@@ -0,0 +1,150 @@
+//
+//  profile.cpp  -  Timing and statistics of the phases of an MCS search.
+//
+// Copyright (C) 2009, The Regents of the University of Michigan
+// See the LICENSE file for details.
+//
+
+#include "profile.h"
+#include <sys/time.h>
+#include <sys/resource.h>
+
+using std::endl;
+
+double Profile::wallTime() {
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + 1e-6 * tv.tv_usec;
+}
+
+double Profile::cpuTime() {
+	struct rusage ruse;
+	getrusage(RUSAGE_SELF, &ruse);
+	return ruse.ru_utime.tv_sec + ruse.ru_stime.tv_sec +
+		1e-6 * (ruse.ru_utime.tv_usec + ruse.ru_stime.tv_usec);
+}
+
+void Profile::enable() {
+	on = true;
+	startWall = lastMCSWall = wallTime();
+	for (int i = 0 ; i < LATENCY_BUCKETS ; i++)  latency[i] = 0;
+	for (int i = 0 ; i < CALLS_BUCKETS ; i++)  calls[i] = 0;
+}
+
+void Profile::addTime(const char* phase, double wall, double cpu) {
+	if (!on)  return;
+
+	unsigned int i = 0;
+	while (i < phases.size() && phases[i].name != phase)  i++;
+	if (i == phases.size()) {
+		Phase p;
+		p.name = phase;
+		p.wall = p.cpu = 0;
+		p.count = 0;
+		phases.push_back(p);
+	}
+	phases[i].wall += wall;
+	phases[i].cpu += cpu;
+	phases[i].count++;
+}
+
+void Profile::addBound(unsigned int bound, double wall, double cpu, unsigned int numFound, int satCalls, int64 conflicts, unsigned int inPlay) {
+	if (!on)  return;
+
+	Bound b;
+	b.bound = bound;
+	b.wall = wall;
+	b.cpu = cpu;
+	b.numFound = numFound;
+	b.satCalls = satCalls;
+	b.conflicts = conflicts;
+	b.inPlay = inPlay;
+	bounds.push_back(b);
+}
+
+void Profile::foundMCS(int satCalls) {
+	if (!on)  return;
+
+	double now = wallTime();
+	double ms = 1000 * (now - lastMCSWall);
+	int i = 0;
+	for (double limit = 0.1 ; i < LATENCY_BUCKETS-1 && ms >= limit ; limit *= 10)  i++;
+	latency[i]++;
+
+	int n = satCalls - lastMCSCalls;
+	int j = 0;
+	while (j < CALLS_BUCKETS-1 && n > (1 << j))  j++;
+	calls[j]++;
+
+	lastMCSWall = now;
+	lastMCSCalls = satCalls;
+	numMCSes++;
+}
+
+void Profile::sampleLearnts(int64 learnts, bool force) {
+	if (!on)  return;
+
+	double now = wallTime();
+	if (!force && lastSampleWall >= 0 && now - lastSampleWall < 1.0)  return;
+
+	Sample s;
+	s.wall = now - startWall;
+	s.learnts = learnts;
+	learntSamples.push_back(s);
+	lastSampleWall = now;
+}
+
+void Profile::writeJSON(std::ostream& out, const string& indent) const {
+	struct rusage ruse;
+	getrusage(RUSAGE_SELF, &ruse);
+
+	out << indent << "\"wall_time\": " << wallTime() - startWall << "," << endl;
+	out << indent << "\"cpu_time\": " << cpuTime() << "," << endl;
+	out << indent << "\"peak_memory_kb\": " << ruse.ru_maxrss << "," << endl;
+
+	// phases (times include those of any phases nested in them)
+	out << indent << "\"phases\": {";
+	for (unsigned int i = 0 ; i < phases.size() ; i++) {
+		out << (i ? "," : "") << endl;
+		out << indent << "  \"" << phases[i].name << "\": {\"wall\": " << phases[i].wall
+			<< ", \"cpu\": " << phases[i].cpu << ", \"count\": " << phases[i].count << "}";
+	}
+	out << endl << indent << "}," << endl;
+
+	out << indent << "\"bounds\": [";
+	for (unsigned int i = 0 ; i < bounds.size() ; i++) {
+		const Bound& b = bounds[i];
+		out << (i ? "," : "") << endl;
+		out << indent << "  {\"bound\": " << b.bound << ", \"wall\": " << b.wall << ", \"cpu\": " << b.cpu
+			<< ", \"mcses\": " << b.numFound << ", \"sat_calls\": " << b.satCalls
+			<< ", \"conflicts\": " << b.conflicts << ", \"in_play\": " << b.inPlay << "}";
+	}
+	out << endl << indent << "]," << endl;
+
+	out << indent << "\"mcs_latency_ms\": {\"mcses\": " << numMCSes << ", \"buckets\": [";
+	double limit = 0.1;
+	for (int i = 0 ; i < LATENCY_BUCKETS ; i++, limit *= 10) {
+		out << (i ? ", " : "");
+		if (i < LATENCY_BUCKETS-1)  out << "{\"below\": " << limit << ", \"count\": " << latency[i] << "}";
+		else  out << "{\"below\": null, \"count\": " << latency[i] << "}";
+	}
+	out << "]}," << endl;
+
+	// trailing empty buckets are left out
+	int lastCalls = CALLS_BUCKETS-1;
+	while (lastCalls > 0 && calls[lastCalls] == 0)  lastCalls--;
+	out << indent << "\"sat_calls_per_mcs\": [";
+	for (int j = 0 ; j <= lastCalls ; j++) {
+		out << (j ? ", " : "") << "{\"at_most\": ";
+		if (j < CALLS_BUCKETS-1)  out << (1 << j);
+		else  out << "null";
+		out << ", \"count\": " << calls[j] << "}";
+	}
+	out << "]," << endl;
+
+	out << indent << "\"learnts\": [";
+	for (unsigned int i = 0 ; i < learntSamples.size() ; i++) {
+		out << (i ? ", " : "") << "{\"wall\": " << learntSamples[i].wall << ", \"learnts\": " << learntSamples[i].learnts << "}";
+	}
+	out << "]" << endl;
+}
@@ -0,0 +1,112 @@
+//
+//  profile.h  -  Timing and statistics of the phases of an MCS search.
+//
+// Copyright (C) 2009, The Regents of the University of Michigan
+// See the LICENSE file for details.
+//
+#ifndef __PROFILE_H
+#define __PROFILE_H
+
+#include "SolverTypes.h"
+#include <ostream>
+#include <string>
+#include <vector>
+
+using std::vector;
+using std::string;
+
+// Collects, once enable()d, the wall-clock and CPU time spent in each phase
+// of the search (see PhaseTimer), per-bound statistics, when each MCS was
+// found (and how many SAT calls it took), and samples of the size of the
+// learnt clause database, for writeJSON().  While disabled, every call is a
+// no-op, so the search can always report to it.
+class Profile {
+public:
+	Profile() : on(false), startWall(0), lastMCSWall(0), lastMCSCalls(0), numMCSes(0), lastSampleWall(-1) {}
+
+	void enable();
+	bool enabled() const { return on; }
+
+	// Time spent in phase (from PhaseTimer); phases may nest
+	void addTime(const char* phase, double wall, double cpu);
+
+	// A bound of the bounded search is done
+	void addBound(unsigned int bound, double wall, double cpu, unsigned int numFound, int satCalls, int64 conflicts, unsigned int inPlay);
+
+	// An MCS was found, after satCalls SAT calls in all
+	void foundMCS(int satCalls);
+
+	// The current learnt clause database has learnts clauses (recorded at
+	// most once a second unless force is set)
+	void sampleLearnts(int64 learnts, bool force = false);
+
+	// Write everything collected (the members of a JSON object, without the
+	// enclosing braces, one per line with the given indent)
+	void writeJSON(std::ostream& out, const string& indent) const;
+
+	static double wallTime();
+	static double cpuTime();
+
+private:
+	struct Phase {
+		string name;
+		double wall;
+		double cpu;
+		unsigned int count;
+	};
+	struct Bound {
+		unsigned int bound;
+		double wall;
+		double cpu;
+		unsigned int numFound;
+		int satCalls;
+		int64 conflicts;
+		unsigned int inPlay;
+	};
+	struct Sample {
+		double wall;
+		int64 learnts;
+	};
+
+	bool on;
+	double startWall;
+	vector<Phase> phases;	// in order of first use
+	vector<Bound> bounds;
+	vector<Sample> learntSamples;
+
+	// Histograms of the time between consecutive MCSes (in ms, by powers of
+	// 10, from < 0.1) and of the SAT calls between them (by powers of 2)
+	static const int LATENCY_BUCKETS = 7;
+	static const int CALLS_BUCKETS = 16;
+	unsigned int latency[LATENCY_BUCKETS];
+	unsigned int calls[CALLS_BUCKETS];
+	double lastMCSWall;
+	int lastMCSCalls;
+	unsigned int numMCSes;
+	double lastSampleWall;
+};
+
+// Adds the time from its construction to its destruction to a phase of the
+// Profile (if enabled)
+class PhaseTimer {
+public:
+	PhaseTimer(Profile& prof, const char* phase) : prof(prof), phase(phase), wall(0), cpu(0) {
+		if (prof.enabled()) {
+			wall = Profile::wallTime();
+			cpu = Profile::cpuTime();
+		}
+	}
+	~PhaseTimer() {
+		if (prof.enabled()) {
+			prof.addTime(phase, Profile::wallTime() - wall, Profile::cpuTime() - cpu);
+		}
+	}
+
+private:
+	Profile& prof;
+	const char* phase;
+	double wall;
+	double cpu;
+};
+
+#endif // __PROFILE_H
@@ -0,0 +1,13 @@
+//
+//  satbackend.cpp  -  Selection of the SAT backend.
+//
+// Copyright (C) 2009, The Regents of the University of Michigan
+// See the LICENSE file for details.
+//
+
+#include "satbackend.h"
+#include "minisatbackend.h"
+
+SATBackend* newSATBackend() {
+	return new MinisatBackend();
+}
@@ -0,0 +1,81 @@
+//
+//  satbackend.h  -  Interface to the incremental SAT solver used for
+//                   finding MCSes.
+//
+// Copyright (C) 2009, The Regents of the University of Michigan
+// See the LICENSE file for details.
+//
+#ifndef __SATBACKEND_H
+#define __SATBACKEND_H
+
+#include "SolverTypes.h"
+#include "defs.h"
+
+// Everything MCSfinder and Parser need from a SAT solver.  The solver is
+// incremental: clauses can be added between calls to solve(), each of which
+// can assume some literals for that call only.
+//
+// A new backend is a subclass of this plus a case in newSATBackend(); the
+// embedded MiniSat Solver (minisatbackend.h) is the reference one.
+class SATBackend {
+public:
+	virtual ~SATBackend() {}
+
+	// Problem specification
+	virtual Var newVar() = 0;
+	virtual int nVars() = 0;
+	// Returns FALSE upon immediate conflict.  A clause may carry the (1-based)
+	// id of the input clause it comes from, or the ids of several, for
+	// derivations (see enableDeriv()); 0 is no id.
+	virtual bool addClause(const vec<Lit>& ps, unsigned int id = 0) = 0;
+	virtual bool addClause(const vec<Lit>& ps, const Bag& ids) = 0;
+	bool addUnit(Lit p, unsigned int id = 0) {
+		vec<Lit> ps;
+		ps.push(p);
+		return addClause(ps, id);
+	}
+	// At most n of the literals in ps are TRUE
+	virtual bool addAtMost(const vec<Lit>& ps, int n) = 0;
+	// FALSE once the clauses are known to be unsatisfiable
+	virtual bool okay() = 0;
+
+	// Solve under the given assumptions.  If satisfiable, model() is then a
+	// model (one value per variable); if not, conflict() holds the negations
+	// of the assumptions responsible (empty if unsatisfiable without any).
+	virtual bool solve(const vec<Lit>& assumps) = 0;
+	bool solve() { vec<Lit> none; return solve(none); }
+	virtual const vec<bool>& model() = 0;
+	virtual const vec<Lit>& conflict() = 0;
+
+	// Derivations: with enableDeriv() called before any clauses are added,
+	// getDerivation() adds the ids of the clauses that an unsatisfiable
+	// result (without assumptions) was derived from to ids.
+	virtual void enableDeriv() = 0;
+	virtual void getDerivation(Bag& ids) = 0;
+
+	// Decision heuristics: decide v before all other (non-prioritized)
+	// variables, and try value b first for it.  (Without these, TRUE is tried
+	// first for every variable.)
+	virtual void prioritize(Var v) = 0;
+	virtual void setPolarity(Var v, bool b) = 0;
+
+	virtual const SolverStats& stats() = 0;
+};
+
+// A new, empty instance of the SAT backend in use
+SATBackend* newSATBackend();
+
+// A new SAT backend (newSATBackend()) for the life of a scope
+class ScopedSAT {
+public:
+	ScopedSAT() : sat(newSATBackend()) {}
+	~ScopedSAT() { delete sat; }
+	SATBackend& operator*() { return *sat; }
+
+private:
+	SATBackend* sat;
+	ScopedSAT(const ScopedSAT&);
+	ScopedSAT& operator=(const ScopedSAT&);
+};
+
+#endif // __SATBACKEND_H
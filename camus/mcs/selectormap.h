@@ -0,0 +1,58 @@
+//
+//  selectormap.h  -  Mapping between y-variables (clause/group selectors)
+//                    and the Solver variables that represent them.
+//
+// Copyright (C) 2009, The Regents of the University of Michigan
+// See the LICENSE file for details.
+//
+#ifndef __SELECTORMAP_H
+#define __SELECTORMAP_H
+
+#include "SolverTypes.h"
+#include "defs.h"
+#include <vector>
+
+// Only the selectors "in play" get a Solver variable; they are numbered
+// consecutively after the CNF variables.  Every other selector is fixed to
+// TRUE, i.e. its clauses are added to the Solver as they are (with the
+// selector's id as their derivation) and any blocking clause containing it is
+// already satisfied.
+//
+// With core guidance, the selectors in play are just those in the current
+// core, so the Solver never sees variables for the rest of the formula.
+class SelectorMap {
+public:
+	// Only selectors with (1-based) ids in inPlay are in play, or all of
+	// them (selector y is then variable base+y) if inPlay is NULL, except
+	// for those with ids in fixed (if given), which are always fixed TRUE
+	SelectorMap(unsigned int base, unsigned int nY, const Bag* inPlay = NULL, const Bag* fixed = NULL) : base(base), toVar(nY, var_Undef) {
+		for (Num y = 0 ; y < nY ; y++) {
+			if (fixed != NULL && fixed->find(y+1) != fixed->end())  continue;
+			if (inPlay == NULL || inPlay->find(y+1) != inPlay->end()) {
+				toVar[y] = base + fromVar.size();
+				fromVar.push_back(y);
+			}
+		}
+	}
+
+	inline bool inPlay(Num y) const		{ return toVar[y] != var_Undef; }
+	inline Var var(Num y) const			{ return toVar[y]; }
+	inline Lit lit(Num y) const			{ return Lit(toVar[y]); }
+
+	// Number of selectors in play, and the k-th of them
+	inline unsigned int size() const		{ return fromVar.size(); }
+	inline Num selector(unsigned int k) const	{ return fromVar[k]; }
+
+	// The selector represented by Solver variable v (v must be a selector variable)
+	inline Num selectorOf(Var v) const	{ return fromVar[v - base]; }
+
+	// Total Solver variables needed (CNF variables plus selectors in play)
+	inline unsigned int nVars() const	{ return base + fromVar.size(); }
+
+private:
+	unsigned int base;
+	std::vector<Var> toVar;	// selector -> Solver variable (var_Undef if not in play)
+	std::vector<Num> fromVar;	// (Solver variable - base) -> selector
+};
+
+#endif // __SELECTORMAP_H
@@ -0,0 +1,117 @@
+//
+//  subsumption.cpp  -  Incremental index for subsumption checks between MCSes/PCSes.
+//
+// Copyright (C) 2009, The Regents of the University of Michigan
+// See the LICENSE file for details.
+//
+
+#include "subsumption.h"
+#include <algorithm>
+
+uint64_t SubsumptionIndex::signature(const MCSBag& set) {
+	uint64_t sig = 0;
+	for (MCSBag::const_iterator it = set.begin() ; it != set.end() ; it++) {
+		sig |= bit(*it);
+	}
+	return sig;
+}
+
+void SubsumptionIndex::growTo(Num n) {
+	if (n >= occurs.size()) {
+		occurs.resize(n+1);
+		watches.resize(n+1);
+	}
+}
+
+void SubsumptionIndex::insert(unsigned int id, const MCSBag& set) {
+	if (id >= entries.size())  entries.resize(id+1);
+
+	Entry& e = entries[id];
+	e.elems = set;
+	std::sort(e.elems.begin(), e.elems.end());
+	e.sig = signature(e.elems);
+	e.live = true;
+	numLive++;
+
+	if (e.elems.empty())  return;
+
+	// watch the set on its currently rarest element
+	Num rarest = e.elems[0];
+	for (MCSBag::iterator it = e.elems.begin() ; it != e.elems.end() ; it++) {
+		growTo(*it);
+		if (occurs[*it].size() < occurs[rarest].size())  rarest = *it;
+	}
+	watches[rarest].push_back(id);
+
+	for (MCSBag::iterator it = e.elems.begin() ; it != e.elems.end() ; it++) {
+		occurs[*it].push_back(id);
+	}
+}
+
+// Removal is lazy: dead ids are dropped from the lists when next scanned.
+void SubsumptionIndex::remove(unsigned int id) {
+	if (!isLive(id))  return;
+	entries[id].live = false;
+	entries[id].elems.clear();
+	numLive--;
+}
+
+bool SubsumptionIndex::hasSubset(const MCSBag& set) {
+	MCSBag sorted(set);
+	std::sort(sorted.begin(), sorted.end());
+	uint64_t sig = signature(sorted);
+
+	// any subset of the set is watched on one of the set's elements
+	for (MCSBag::iterator it = sorted.begin() ; it != sorted.end() ; it++) {
+		if (*it >= watches.size())  break;
+		vector<unsigned int>& ws = watches[*it];
+		unsigned int j = 0;
+		bool found = false;
+		for (unsigned int i = 0 ; i < ws.size() ; i++) {
+			if (!isLive(ws[i]))  continue;
+			ws[j++] = ws[i];
+			if (found)  continue;
+
+			const Entry& e = entries[ws[i]];
+			if (e.elems.size() <= sorted.size()
+					&& (e.sig & ~sig) == 0
+					&& std::includes(sorted.begin(), sorted.end(), e.elems.begin(), e.elems.end())) {
+				found = true;
+			}
+		}
+		ws.resize(j);
+		if (found)  return true;
+	}
+	return false;
+}
+
+void SubsumptionIndex::findSupersets(const MCSBag& set, vector<unsigned int>& out) {
+	if (set.empty())  return;
+
+	MCSBag sorted(set);
+	std::sort(sorted.begin(), sorted.end());
+	uint64_t sig = signature(sorted);
+
+	// every superset appears in the occurrence list of each element of the set,
+	// so it suffices to scan the shortest of those lists
+	Num rarest = sorted[0];
+	for (MCSBag::iterator it = sorted.begin() ; it != sorted.end() ; it++) {
+		if (*it >= occurs.size())  return;  // no set contains this element
+		if (occurs[*it].size() < occurs[rarest].size())  rarest = *it;
+	}
+
+	vector<unsigned int>& os = occurs[rarest];
+	unsigned int j = 0;
+	for (unsigned int i = 0 ; i < os.size() ; i++) {
+		if (!isLive(os[i]))  continue;
+		os[j++] = os[i];
+
+		const Entry& e = entries[os[i]];
+		if (e.elems.size() > sorted.size()
+				&& (sig & ~e.sig) == 0
+				&& std::includes(e.elems.begin(), e.elems.end(), sorted.begin(), sorted.end())) {
+			out.push_back(os[i]);
+		}
+	}
+	os.resize(j);
+}
@@ -0,0 +1,63 @@
+//
+//  subsumption.h  -  Incremental index for subsumption checks between MCSes/PCSes.
+//
+// Copyright (C) 2009, The Regents of the University of Michigan
+// See the LICENSE file for details.
+//
+#ifndef __SUBSUMPTION_H
+#define __SUBSUMPTION_H
+
+#include "defs.h"
+#include <vector>
+#include <stdint.h>
+
+using std::vector;
+
+// Holds a growing family of sets (each identified by the caller's id) and
+// answers "is anything in the family a subset of S?" and "which sets in the
+// family are supersets of S?" without scanning the whole family.
+//
+// Every set is kept in the occurrence list of each of its elements (used for
+// superset queries, which scan only the list of the rarest element of S), and
+// in a single watch list keyed by its own rarest element at insertion time
+// (used for subset queries, so each candidate is visited at most once).  A
+// 64-bit signature (one bit per element mod 64) rejects most candidates
+// before the sorted element lists are compared.
+class SubsumptionIndex {
+public:
+	SubsumptionIndex() : numLive(0) {}
+
+	void insert(unsigned int id, const MCSBag& set);
+	void remove(unsigned int id);
+
+	// TRUE if some indexed set is a subset of (or equal to) the given set
+	bool hasSubset(const MCSBag& set);
+
+	// Add to out the ids of all indexed sets that strictly contain the given set
+	void findSupersets(const MCSBag& set, vector<unsigned int>& out);
+
+	unsigned int size() const { return numLive; }
+
+private:
+	struct Entry {
+		MCSBag elems;	// sorted
+		uint64_t sig;
+		bool live;
+		Entry() : sig(0), live(false) {}
+	};
+
+	vector<Entry> entries;				// indexed by id
+	vector< vector<unsigned int> > occurs;	// element -> ids of sets containing it
+	vector< vector<unsigned int> > watches;	// element -> ids of sets watched on it
+	unsigned int numLive;
+
+	static uint64_t signature(const MCSBag& set);
+	static inline uint64_t bit(Num n) { return (uint64_t)1 << (n & 63); }
+
+	inline bool isLive(unsigned int id) const {
+		return id < entries.size() && entries[id].live;
+	}
+	void growTo(Num n);
+};
+
+#endif // __SUBSUMPTION_H
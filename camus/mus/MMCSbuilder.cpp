@@ -0,0 +1,186 @@
+/*
+ *  MMCSbuilder.cpp  -  Constructing MUSes from MCSes with the MMCS minimal
+ *  hitting set algorithm
+ *
+ * Copyright (C) 2009, The Regents of the University of Michigan
+ * See the LICENSE file for details.
+ *
+ */
+
+#include "MMCSbuilder.h"
+#include <algorithm>
+
+#define DEPTHINDENT for (int i=depth;i-->0;) printf("  ");
+
+bool MMCSbuilder::constructMUS(const list<Cover>& MUSCovers, const ClauseAssign& assign) {
+	covers.clear();
+	occurs.assign(assign.size(), vector<Num>());
+	for (list<Cover>::const_iterator it = MUSCovers.begin() ; it != MUSCovers.end() ; it++) {
+		Num cover = covers.size();
+		covers.push_back(vector<Num>(it->begin(), it->end()));
+		for (Cover::const_iterator it2 = it->begin() ; it2 != it->end() ; it2++) {
+			occurs[*it2].push_back(cover);
+		}
+	}
+
+	hittingSet.clear();
+	cand.assign(assign.size(), 1);
+	hitCount.assign(covers.size(), 0);
+	hitXor.assign(covers.size(), 0);
+	critCount.assign(assign.size(), 0);
+	uncov.clear();
+	uncovPos.resize(covers.size());
+	for (Num cover = 0 ; cover < covers.size() ; cover++) {
+		uncovPos[cover] = uncov.size();
+		uncov.push_back(cover);
+	}
+
+	search();
+	return false;
+}
+
+void MMCSbuilder::search() {
+	nodes++;
+
+	if (uncov.empty()) {
+		outputMUS();
+		return;
+	}
+
+	// branch on the uncovered cover with the fewest candidates
+	int best = -1;
+	unsigned int bestCount = 0;
+	for (vector<Num>::iterator it = uncov.begin() ; it != uncov.end() ; it++) {
+		unsigned int count = 0;
+		const vector<Num>& c = covers[*it];
+		for (vector<Num>::const_iterator it2 = c.begin() ; it2 != c.end() ; it2++) {
+			count += cand[*it2];
+		}
+		if (best < 0 || count < bestCount) {
+			best = *it;
+			bestCount = count;
+			if (count == 0) { break; }
+		}
+	}
+	if (bestCount == 0) {
+		// that cover can no longer be hit
+		return;
+	}
+
+	if (verbose) {
+		DEPTHINDENT
+		printf("MMCS branching on cover %d (%d candidates)\n", best, bestCount);
+	}
+
+	// Each clause of the cover is added to S in turn.  The ones not yet
+	// tried are left out of the candidates for its subtree, so that each
+	// hitting set is found only under the first of its clauses tried here.
+	vector<Num> branch;
+	const vector<Num>& c = covers[best];
+	for (vector<Num>::const_iterator it = c.begin() ; it != c.end() ; it++) {
+		if (cand[*it]) {
+			branch.push_back(*it);
+			cand[*it] = 0;
+		}
+	}
+	for (vector<Num>::iterator it = branch.begin() ; it != branch.end() ; it++) {
+		add(*it);
+		if (isMinimal()) {
+			depth++;
+			search();
+			depth--;
+		}
+		remove(*it);
+		cand[*it] = 1;
+	}
+}
+
+// Add a clause to S
+inline void MMCSbuilder::add(Num clause) {
+	const vector<Num>& occ = occurs[clause];
+	for (vector<Num>::const_iterator it = occ.begin() ; it != occ.end() ; it++) {
+		Num cover = *it;
+		if (hitCount[cover] == 0) {
+			removeUncov(cover);
+			critCount[clause]++;
+		}
+		else if (hitCount[cover] == 1) {
+			// its clause in S is no longer the only one
+			critCount[hitXor[cover]]--;
+		}
+		hitCount[cover]++;
+		hitXor[cover] ^= clause;
+	}
+	hittingSet.push_back(clause);
+}
+
+// Remove the clause last added to S (undoing add() exactly, in reverse)
+inline void MMCSbuilder::remove(Num clause) {
+	hittingSet.pop_back();
+	const vector<Num>& occ = occurs[clause];
+	for (vector<Num>::const_reverse_iterator it = occ.rbegin() ; it != occ.rend() ; it++) {
+		Num cover = *it;
+		hitCount[cover]--;
+		hitXor[cover] ^= clause;
+		if (hitCount[cover] == 0) {
+			restoreUncov(cover);
+			critCount[clause]--;
+		}
+		else if (hitCount[cover] == 1) {
+			critCount[hitXor[cover]]++;
+		}
+	}
+}
+
+// Remove a cover from uncov (moving the last one into its place), leaving
+// its position in uncovPos for restoreUncov()
+inline void MMCSbuilder::removeUncov(Num cover) {
+	Num pos = uncovPos[cover];
+	Num last = uncov.back();
+	uncov[pos] = last;
+	uncovPos[last] = pos;
+	uncov.pop_back();
+	uncovPos[cover] = pos;
+}
+
+// Put a cover back into uncov where it was (given that every cover removed
+// since has been put back)
+inline void MMCSbuilder::restoreUncov(Num cover) {
+	Num pos = uncovPos[cover];
+	if (pos < uncov.size()) {
+		Num moved = uncov[pos];
+		uncovPos[moved] = uncov.size();
+		uncov.push_back(moved);
+		uncov[pos] = cover;
+	}
+	else {
+		uncov.push_back(cover);
+	}
+}
+
+inline bool MMCSbuilder::isMinimal() {
+	for (vector<Num>::iterator it = hittingSet.begin() ; it != hittingSet.end() ; it++) {
+		if (critCount[*it] == 0) { return false; }
+	}
+	return true;
+}
+
+// print S, in the same order as MUSbuilder (by compressed clause number)
+void MMCSbuilder::outputMUS() {
+	numFound++;
+
+	vector<Num> sorted(hittingSet);
+	sort(sorted.begin(), sorted.end());
+
+	outLine.clear();
+	startMUS(outLine);
+	for (vector<Num>::iterator it = sorted.begin() ; it != sorted.end() ; it++) {
+		appendClause(outLine, *it);
+	}
+	outLine += '\n';
+	fputs(outLine.c_str(), stdout);
+}
+
+void MMCSbuilder::printStats(FILE* out) {
+	fprintf(out, "MMCS search: %llu nodes, %llu MUSes\n", nodes, numFound);
+}
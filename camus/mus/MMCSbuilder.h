@@ -0,0 +1,74 @@
+/*
+ *  MMCSbuilder.h  -  Constructing MUSes from MCSes with the MMCS minimal
+ *  hitting set algorithm
+ *
+ * Copyright (C) 2009, The Regents of the University of Michigan
+ * See the LICENSE file for details.
+ *
+ */
+
+#ifndef MMCSBUILDER_H
+#define MMCSBUILDER_H
+
+#include <vector>
+
+#include "hsengine.h"
+
+// MMCS (Murakami and Uno), as in shd31/shd.c: grow a hitting set S one
+// clause at a time, each time branching on the clauses of one uncovered
+// cover that are still candidates, and cut a branch as soon as some clause
+// of S is no longer critical (the only clause of S in some cover), since no
+// superset of S is then minimal.  Every minimal hitting set (MUS) is found
+// exactly once, and no other.  Unlike MUSbuilder, nothing is stored about
+// the nodes visited, so memory use is linear in the size of the input.
+class MMCSbuilder : public HSEngine {
+private:
+	// The covers, as lists of (compressed) clauses, and for each clause the
+	// covers that contain it
+	vector< vector<Num> > covers;
+	vector< vector<Num> > occurs;
+
+	// The search state, updated in place by add() and remove()
+	vector<Num> hittingSet;		// S
+	vector<char> cand;			// the clauses that may still be added to S
+	vector<int> hitCount;		// |S & cover| for each cover
+	vector<Num> hitXor;			// XOR of the clauses in S & cover (so the
+								//   clause itself where hitCount is 1)
+	vector<int> critCount;		// covers for which each clause of S is critical
+	vector<Num> uncov;			// covers not hit by S, in no fixed order
+	vector<Num> uncovPos;		//   and the position of each in uncov
+
+	unsigned int depth;
+	unsigned long long nodes;
+	unsigned long long numFound;
+	string outLine;
+
+	void search();
+
+	// Add a clause to S, or remove the clause last added
+	inline void add(Num clause);
+	inline void remove(Num clause);
+	inline void removeUncov(Num cover);
+	inline void restoreUncov(Num cover);
+
+	// Is every clause in S critical?
+	inline bool isMinimal();
+
+	void outputMUS();
+
+public:
+	MMCSbuilder() :
+		depth(0),
+		nodes(0),
+		numFound(0)
+	{ }
+
+	// Construct all MUSes from the given covers (the assignment only gives
+	// the number of clauses)
+	bool constructMUS(const list<Cover>& MUSCovers, const ClauseAssign& assign);
+
+	// Report the number of search nodes and MUSes
+	void printStats(FILE* out);
+};
+
+#endif
@@ -11,32 +11,15 @@
 
 #include "MUSbuilder.h"
 #include <map>
+#include <deque>
 #include <cassert>
-
-/* ///  HEY!  (11-10-04)  IDEA.
-///
-///  Employ dynamic programming to remember the result of every subproblem
-///  Subproblem = all partial MUSes in these remaining covers
-///  Could store some kind of tree of results:  Just the clauses chosen at each
-///   spot, so getting them is easy, with pointers to the next spots
-///  Potential problem:  Gonna be *lots* of stored results, no?
-///   Lesse, one number per node...  max n numbers (n = number clauses in all covers)
-///   Hm...  if the tree "reconverges" enough, it might work well... ?
-///  Worth trying...  some day.  :)
-///
-///  Possible implementation:  Standard (STL?) tree structure, hash (of remaining
-///   subproblem = remaining covers?) pointing to nodes in tree
-///   When get a hit in the hash, make link from current node to hashed location
-///   for next time the *current* node is hit in the hash...
-///
-///  Tricky...  maybe not worth it...  but worth trying.
-///
-*/
+#include <cmath>
+#include <pthread.h>
 
 #define DEPTHINDENT for (int i=depth;i-->0;) printf("  ");
-#define PRINTCOVERS for (list<Cover>::iterator M_itCover = covers.begin() ; M_itCover != covers.end() ; M_itCover++) { \
-					  for (Cover::iterator M_itTEMP = M_itCover->begin() ; M_itTEMP != M_itCover->end() ; M_itTEMP++) { \
-						printf("%d ",*M_itTEMP); \
+#define PRINTCOVERS for (int M_itCover = coverNext[head()] ; M_itCover != head() ; M_itCover = coverNext[M_itCover]) { \
+					  for (int M_itTEMP = covers[M_itCover].first() ; M_itTEMP >= 0 ; M_itTEMP = covers[M_itCover].next(M_itTEMP)) { \
+						printf("%d ",M_itTEMP); \
 					  } \
 					  printf("\n"); \
 					}
@@ -105,9 +88,476 @@ void MUSbuilder::generateMappingStraight(const list<Cover>& MUSCovers, ClauseMap
 
 
 
-// construct MUSes from a set of covers and clauses
+// State shared by the threads of a parallel search.
+// Each thread takes tasks (search nodes) from the queue and searches them
+// depth-first, as in the sequential search.  A thread with nothing to do
+// counts itself as hungry; while any thread is, the others hand over the
+// next child node they would have recursed into (see constructMUS()) instead
+// of searching it themselves, so work moves to idle threads as soon as they
+// ask for it.  The search is over when every thread is hungry.
+// numQueued, hungry, bbUpper, and stop are also read without a lock, so every
+// access to them is atomic.
+template<class T> static inline T atomicGet(const T& x) { return __atomic_load_n(&x, __ATOMIC_RELAXED); }
+template<class T> static inline void atomicSet(T& x, T value) { __atomic_store_n(&x, value, __ATOMIC_RELAXED); }
+
+struct ParallelSearch {
+	MUSbuilder* owner;
+
+	pthread_mutex_t lock;
+	pthread_cond_t wake;
+	deque<SearchTask*> tasks;
+	int numQueued;		// tasks.size()
+	int hungry;
+	bool finished;
+	unsigned long long tasksRun;
+
+	SharedVisitedTable beenHere;
+	SharedVisitedTable musesSeen;
+
+	pthread_mutex_t outputLock;
+	int bbUpper;
+	bool stop;
+
+	ParallelSearch(MUSbuilder* owner) :
+		owner(owner), numQueued(0), hungry(0), finished(false), tasksRun(0),
+		bbUpper(std::numeric_limits<int>::max()), stop(false)
+	{
+		pthread_mutex_init(&lock, NULL);
+		pthread_cond_init(&wake, NULL);
+		pthread_mutex_init(&outputLock, NULL);
+	}
+	~ParallelSearch() {
+		for (deque<SearchTask*>::iterator it = tasks.begin() ; it != tasks.end() ; it++)  delete *it;
+		pthread_mutex_destroy(&lock);
+		pthread_cond_destroy(&wake);
+		pthread_mutex_destroy(&outputLock);
+	}
+
+	inline bool wantsWork() { return atomicGet(hungry) > atomicGet(numQueued); }
+	void give(SearchTask* task) {
+		pthread_mutex_lock(&lock);
+		tasks.push_back(task);
+		atomicSet(numQueued, numQueued + 1);
+		pthread_cond_signal(&wake);
+		pthread_mutex_unlock(&lock);
+	}
+};
+
+// Per-thread output is collected up to this size before it is written out
+static const size_t OUTPUT_BUFFER_SIZE = 1 << 16;
+
+// The splitmix64 finalizer
+static inline Word mix64(Word z) {
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	return z ^ (z >> 31);
+}
+
+MUSbuilder::~MUSbuilder() {
+	// (the copies made for the threads share the original's)
+	if (parallel == NULL || parallel->owner == this)  delete memo;
+	if (parallel != NULL && parallel->owner == this)  delete parallel;
+}
+
+// set up the search state from the given covers and assignment and search it
+bool MUSbuilder::constructMUS(const list<Cover>& MUSCovers, const ClauseAssign& assign) {
+	vector<BitCover> rootCovers;
+	for (list<Cover>::const_iterator itCover = MUSCovers.begin() ; itCover != MUSCovers.end() ; itCover++) {
+		rootCovers.push_back(BitCover(*itCover, assign.size()));
+	}
+
+	// random keys for the fingerprints (from a fixed seed, with splitmix64)
+	zobrist.resize(2 * assign.size());
+	Word seed = 0;
+	for (vector<Fingerprint>::iterator it = zobrist.begin() ; it != zobrist.end() ; it++) {
+		Word* halves[2] = { &it->lo, &it->hi };
+		for (int h = 0 ; h < 2 ; h++) {
+			*halves[h] = mix64(seed += 0x9E3779B97F4A7C15ULL);
+		}
+	}
+
+	if (maxSize >= 0) {
+		bbUpper = maxSize - (int)singletons.size() + 1;
+	}
+	activity.assign(assign.size(), 0.0);
+	activityInc = 1;
+	if (topK > 0 || maxSize >= 0 || sizeOrder) {
+		doBB = true;
+	}
+
+	bool result;
+	if (sizeOrder) {
+		result = constructMUSBySize(rootCovers, assign);
+	}
+	else {
+		result = search(rootCovers, assign);
+	}
+
+	if (topK > 0 && !sizeOrder) {
+		// output the smallest MUSes found, smallest first
+		sort_heap(kBest.begin(), kBest.end());
+		for (vector< pair<int,string> >::iterator it = kBest.begin() ; it != kBest.end() ; it++) {
+			fputs(it->second.c_str(), stdout);
+		}
+	}
+	return result;
+}
+
+// search the root node (with one or more threads)
+bool MUSbuilder::search(const vector<BitCover>& rootCovers, const ClauseAssign& assign) {
+	if (numThreads > 1) {
+		return constructMUSParallel(rootCovers, assign);
+	}
+
+	loadState(rootCovers, assign);
+	return constructMUS();
+}
+
+// Pick the next clause to branch on at the current node (by the branching
+// strategy), or return -1 if there are none left.  In the static order,
+// next is the clause number to go on from.
+inline int MUSbuilder::chooseClause(unsigned int& next) {
+	if (branching == BRANCH_STATIC) {
+		while (next < curAssign.size() && curAssign[next] != 0) { next++; }
+		return (next < curAssign.size()) ? (int)next++ : -1;
+	}
+
+	int best = -1;
+	if (branching == BRANCH_SMALLEST_COVER) {
+		int smallest = -1;
+		for (int itCover = coverNext[head()] ; itCover != head() ; itCover = coverNext[itCover]) {
+			if (smallest < 0 || covers[itCover].size() < covers[smallest].size()) { smallest = itCover; }
+		}
+		if (smallest < 0) { return -1; }
+		const BitCover& c = covers[smallest];
+		for (int clause = c.first() ; clause >= 0 ; clause = c.next(clause)) {
+			if (best < 0 || activity[clause] > activity[best]) { best = clause; }
+		}
+		return best;
+	}
+
+	// (every clause of a remaining cover is unassigned, and only those matter)
+	for (unsigned int clause = 0 ; clause < curAssign.size() ; clause++) {
+		if (curAssign[clause] != 0 || occurs[clause] == 0) { continue; }
+		if (best < 0) {
+			best = clause;
+			continue;
+		}
+		int diff = occurs[clause] - occurs[best];
+		if (branching == BRANCH_MOST) { diff = -diff; }
+		if (diff < 0 || (diff == 0 && activity[clause] > activity[best])) { best = clause; }
+	}
+	return best;
+}
+
+// Raise the activity of a clause whose children were cut off by the bound,
+// by an amount that grows each time (so older bumps count for less)
+inline void MUSbuilder::bumpActivity(Num clause) {
+	if (branching == BRANCH_STATIC) { return; }
+	activity[clause] += activityInc;
+	activityInc *= 1.05;
+	if (activityInc > 1e100) {
+		for (vector<double>::iterator it = activity.begin() ; it != activity.end() ; it++) { *it *= 1e-100; }
+		activityInc *= 1e-100;
+	}
+}
+
+// Iterative deepening: search for the MUSes of each size in turn, until one
+// search is not cut off by the bound anywhere (so there are no larger MUSes
+// left), or enough are output.  Each search starts afresh, as the nodes
+// visited in the last were only searched for smaller MUSes.
+bool MUSbuilder::constructMUSBySize(const vector<BitCover>& rootCovers, const ClauseAssign& assign) {
+	int last = (maxSize >= 0) ? maxSize - (int)singletons.size() : std::numeric_limits<int>::max() - 1;
+	for (minSize = 0 ; minSize <= last ; minSize++) {
+		bbUpper = minSize + 1;
+		boundHits = 0;
+		beenHere.clear();
+		musesSeen.clear();
+
+		search(rootCovers, assign);
+
+		if (wasInterrupted() || boundHits == 0 || (topK > 0 && numOutput >= topK)) { break; }
+	}
+	return false;
+}
+
+// make the given covers and assignment the current search state
+void MUSbuilder::loadState(const vector<BitCover>& newCovers, const ClauseAssign& assign) {
+	covers = newCovers;
+	curAssign = assign;
+	trail.clear();
+
+	int n = covers.size();
+	coverNext.resize(n+1);
+	coverPrev.resize(n+1);
+	for (int i = 0 ; i <= n ; i++) {
+		coverNext[i] = (i+1) % (n+1);
+		coverPrev[i] = (i+n) % (n+1);
+	}
+
+	curPrint.lo = curPrint.hi = 0;
+	for (Num i = 0 ; i < curAssign.size() ; i++) {
+		updatePrint(i, curAssign[i]);
+	}
+
+	occurs.assign(curAssign.size(), 0);
+	clauseCovers.assign(curAssign.size(), vector<int>());
+	for (int cover = 0 ; cover < n ; cover++) {
+		const BitCover& c = covers[cover];
+		for (int clause = c.first() ; clause >= 0 ; clause = c.next(clause)) {
+			occurs[clause]++;
+			clauseCovers[clause].push_back(cover);
+		}
+	}
+	coverLive.assign(n, 1);
+	numLive = n;
+	coverMark.assign(n, 0);
+}
+
+// copy the current search state (just the remaining covers) into a new task
+SearchTask* MUSbuilder::saveState() {
+	SearchTask* task = new SearchTask;
+	for (int itCover = coverNext[head()] ; itCover != head() ; itCover = coverNext[itCover]) {
+		task->covers.push_back(covers[itCover]);
+	}
+	task->assign = curAssign;
+	task->depth = depth;
+	return task;
+}
+
+// search the root node with numThreads threads, each with its own copy of
+// this MUSbuilder
+bool MUSbuilder::constructMUSParallel(const vector<BitCover>& rootCovers, const ClauseAssign& assign) {
+	// (with iterative deepening, the shared state is reused for each search)
+	if (parallel == NULL) {
+		parallel = new ParallelSearch(this);
+		parallel->beenHere.setMaxBytes(maxVisitedBytes);
+		if (stopRequested) { parallel->stop = true; }
+	}
+	else {
+		parallel->hungry = 0;
+		parallel->finished = false;
+		parallel->beenHere.clear();
+		parallel->musesSeen.clear();
+	}
+	parallel->bbUpper = bbUpper;
+
+	SearchTask* root = new SearchTask;
+	root->covers = rootCovers;
+	root->assign = assign;
+	root->depth = depth;
+	parallel->tasks.push_back(root);
+	parallel->numQueued = 1;
+
+	vector<MUSbuilder*> workers;
+	vector<pthread_t> threads(numThreads);
+	// (copied before any thread starts, as they update kBest and numOutput here)
+	for (int t = 0 ; t < numThreads ; t++) {
+		workers.push_back(new MUSbuilder(*this));
+		workers[t]->boundHits = 0;
+	}
+	for (int t = 0 ; t < numThreads ; t++) {
+		if (pthread_create(&threads[t], NULL, worker, workers[t]) != 0) {
+			fprintf(stderr, "ERROR: Could not create a thread.\n");
+			exit(1);
+		}
+	}
+	for (int t = 0 ; t < numThreads ; t++) {
+		pthread_join(threads[t], NULL);
+		boundHits += workers[t]->boundHits;
+		delete workers[t];
+	}
+	fflush(stdout);
+
+	bbUpper = atomicGet(parallel->bbUpper);
+	return false;
+}
+
+void* MUSbuilder::worker(void* arg) {
+	((MUSbuilder*)arg)->runTasks();
+	return NULL;
+}
+
+// take tasks from the queue and search them until there are no more
+void MUSbuilder::runTasks() {
+	pthread_mutex_lock(&parallel->lock);
+	while (true) {
+		if (!parallel->tasks.empty()) {
+			SearchTask* task = parallel->tasks.front();
+			parallel->tasks.pop_front();
+			atomicSet(parallel->numQueued, parallel->numQueued - 1);
+			parallel->tasksRun++;
+			pthread_mutex_unlock(&parallel->lock);
+
+			loadState(task->covers, task->assign);
+			depth = task->depth;
+			delete task;
+			constructMUS();
+
+			pthread_mutex_lock(&parallel->lock);
+			continue;
+		}
+		if (parallel->finished)  break;
+
+		atomicSet(parallel->hungry, parallel->hungry + 1);
+		if (parallel->hungry == numThreads) {
+			// nothing is left to search, and nobody can make more
+			parallel->finished = true;
+			pthread_cond_broadcast(&parallel->wake);
+			break;
+		}
+		pthread_cond_wait(&parallel->wake, &parallel->lock);
+		atomicSet(parallel->hungry, parallel->hungry - 1);
+	}
+	pthread_mutex_unlock(&parallel->lock);
+
+	flushOutput();
+}
+
+bool MUSbuilder::interrupt() {
+	stopRequested = 1;
+	if (parallel != NULL)  atomicSet(parallel->stop, true);
+	return true;
+}
+
+bool MUSbuilder::wasInterrupted() {
+	return stopped();
+}
+
+// (the threads of a parallel search each have their own stopRequested, so
+// they are stopped through parallel)
+inline bool MUSbuilder::stopped() {
+	return stopRequested || (parallel != NULL && atomicGet(parallel->stop));
+}
+
+// A lower bound (a sum of weights, see lowerBound()) rounded up, allowing for
+// rounding errors in the sum
+static inline int roundBound(double bound) {
+	return (int)ceil(bound - 1e-6);
+}
+
+// Search the current node, or, if its subproblem is in the memo, output the
+// MUSes found there again instead.  Either way, the node's result is added to
+// that of its parent (at the top of memoStack).
+bool MUSbuilder::constructMUS() {
+	if (memo == NULL) {
+		return expandNode();
+	}
+
+	Fingerprint key = coversKey();
+	MemoEntry* parent = memoStack.empty() ? NULL : memoStack.back();
+	Num clause = memoClause;
+
+	MemoEntry* e = memo->find(key);
+	if (e != NULL) {
+		if (verbose) {
+			DEPTHINDENT
+			printf("<--Subproblem in the memo\n");
+		}
+		replayPath.clear();
+		replay(e, positivePrint());
+		if (parent != NULL)  memo->addChild(parent, clause, e);
+		return false;
+	}
+
+	e = memo->create();
+	memoStack.push_back(e);
+	bool stop = expandNode();
+	memoStack.pop_back();
+	if (stop)  memo->makeIncomplete(e);
+
+	memo->insert(key, e);
+	// (results with no MUS in them are left out of their parent's)
+	if (parent != NULL && (!e->complete || e->isMUS || !e->children.empty())) {
+		memo->addChild(parent, clause, e);
+	}
+	memo->release(e);
+	return stop;
+}
+
+// A fingerprint of the remaining covers, as a set of sets: the sum of a hash
+// of each cover, so it does not depend on their order
+Fingerprint MUSbuilder::coversKey() {
+	Fingerprint key;
+	key.lo = key.hi = 0;
+	for (int itCover = coverNext[head()] ; itCover != head() ; itCover = coverNext[itCover]) {
+		const BitCover& c = covers[itCover];
+		Word lo = 0x9E3779B97F4A7C15ULL, hi = 0xD1B54A32D192ED03ULL;
+		for (unsigned int w = 0 ; w < c.numWords() ; w++) {
+			lo = mix64(lo ^ c.word(w));
+			hi = mix64(hi + c.word(w));
+		}
+		key.lo += lo;
+		key.hi += hi;
+	}
+	return key;
+}
+
+// The fingerprint of just the clauses in the MUS under construction (so the
+// same MUS reached with different clauses left out has the same one)
+Fingerprint MUSbuilder::positivePrint() {
+	Fingerprint print;
+	print.lo = print.hi = 0;
+	for (Num i = 0 ; i < curAssign.size() ; i++) {
+		if (curAssign[i] == 1) { print ^= zobrist[2*i]; }
+	}
+	return print;
+}
+
+// Output the MUS under construction completed in every way recorded in a
+// memo result (the clauses added so far being in replayPath, and print
+// being the fingerprint of all the clauses)
+void MUSbuilder::replay(const MemoEntry* e, const Fingerprint& print) {
+	Fingerprint cur = print;
+	unsigned int mark = replayPath.size();
+	for (vector<unsigned int>::const_iterator it = e->forced.begin() ; it != e->forced.end() ; it++) {
+		replayPath.push_back(*it);
+		cur ^= zobrist[2 * *it];
+	}
+
+	if (e->isMUS) {
+		outputReplayed(cur);
+	}
+	for (vector< pair<unsigned int, MemoEntry*> >::const_iterator it = e->children.begin() ; it != e->children.end() ; it++) {
+		replayPath.push_back(it->first);
+		cur ^= zobrist[2 * it->first];
+		replay(it->second, cur);
+		cur ^= zobrist[2 * it->first];
+		replayPath.pop_back();
+	}
+
+	replayPath.resize(mark);
+}
+
+// Output the MUS made of the clauses in curAssign and replayPath, unless it
+// has been output before
+void MUSbuilder::outputReplayed(const Fingerprint& print) {
+	if (musesSeen.insert(print))  return;
+	memo->replayed++;
+
+	vector<Num> mus(replayPath.begin(), replayPath.end());
+	for (Num i = 0 ; i < curAssign.size() ; i++) {
+		if (curAssign[i] == 1) { mus.push_back(i); }
+	}
+	sort(mus.begin(), mus.end());
+
+	startMUS(outBuf);
+	for (vector<Num>::iterator it = mus.begin() ; it != mus.end() ; it++) {
+		appendClause(outBuf, *it);
+	}
+	outBuf += '\n';
+	flushOutput();
+}
+
+// construct MUSes from the current subproblem
 // the first will be constructed in polynomial time (*if* not breaking symmetries)
-bool MUSbuilder::constructMUS(list<Cover> covers, ClauseAssign curAssign) {
+// Changes made to the search state are left on the trail for the caller to undo.
+bool MUSbuilder::expandNode() {
+
+	// unwind quickly once the search is stopped
+	if (stopped()) {
+		return true;
+	}
 
 	if (verbose) {
 		DEPTHINDENT
@@ -115,16 +565,24 @@ bool MUSbuilder::constructMUS(list<Cover> covers, ClauseAssign curAssign) {
 	}
 
 	// quickly take care of any singleton covers (important for speed)
-	propagateSingletons(covers, curAssign);
+	propagateSingletons();
 
+	// the lower bound, and the loads of the clauses under the weights
+	// found for it, kept for bounding the children (see lowerBound())
+	double lower = 0;
+	vector<double> load;
 	if (doBB) {
-		if (curAssign.numPos + mis_quick(covers) >= bbUpper) {
+		if (parallel != NULL) { bbUpper = atomicGet(parallel->bbUpper); }
+		lower = lowerBound();
+		if (curAssign.numPos + roundBound(lower) >= bbUpper) {
 			if (verbose) {
 				DEPTHINDENT
 				printf("Bound hit\n");
 			}
+			boundHits++;
 			return true;
 		}
+		load.swap(clauseLoad);
 	}
 
 	// reasonable defense against duplicate search nodes this check,
@@ -133,7 +591,12 @@ bool MUSbuilder::constructMUS(list<Cover> covers, ClauseAssign curAssign) {
 	//   but be careful to not put the singleton-propagation between them (for
 	//   example), because that will mess it up, potentially yielding duplicate
 	//   MUSes
-	if (isVisited(curAssign)) {
+	bool isMUS = (coverNext[head()] == head());
+	if (isMUS && memo != NULL) {
+		// (even if output already, it completes this subproblem)
+		memoStack.back()->isMUS = true;
+	}
+	if (isVisited(isMUS)) {
 		if(verbose) {
 			DEPTHINDENT
 			printf("<--Been here before!\n");
@@ -141,11 +604,9 @@ bool MUSbuilder::constructMUS(list<Cover> covers, ClauseAssign curAssign) {
 		return false;
 	}
 
-	if (covers.empty()) {
+	if (isMUS) {
 		// nothing left, so this must be an MUS
-		outputMUS(curAssign);
-
-		bbUpper = curAssign.numPos;
+		foundMUS();
 
 		if (verbose) {
 			DEPTHINDENT
@@ -156,13 +617,13 @@ bool MUSbuilder::constructMUS(list<Cover> covers, ClauseAssign curAssign) {
 	}
 
 	// choose a clause to split on
-	for (unsigned int curClause = 0 ; curClause < curAssign.size() ; curClause++) {
+	unsigned int next = 0;
+	for (int curClause = chooseClause(next) ; curClause >= 0 ; curClause = chooseClause(next)) {
 
-		if (curAssign[curClause] != 0) { continue; }
+		if (stopped()) { return true; }
 
 		// include this clause in the MUS
-		curAssign[curClause] = 1;
-		curAssign.numPos++;
+		assign(curClause, 1);
 
 		if (verbose) {
 		 DEPTHINDENT
@@ -170,38 +631,65 @@ bool MUSbuilder::constructMUS(list<Cover> covers, ClauseAssign curAssign) {
 		 // PRINTCOVERS
 		}
 
-		// try splitting on all covers containing the chosen clause
-		for (list<Cover>::iterator itCover = covers.begin() ; itCover != covers.end() ; itCover++) {
+		// every child would hit the bound if the covers left after removing
+		// those containing this clause still weigh enough
+		bool childrenBounded = false;
+		if (doBB) {
+			if (parallel != NULL) { bbUpper = atomicGet(parallel->bbUpper); }
+			childrenBounded = (curAssign.numPos + roundBound(lower - load[curClause]) >= bbUpper);
+			if (childrenBounded) {
+				boundHits++;
+				bumpActivity(curClause);
+			}
+			if (childrenBounded && verbose) {
+				DEPTHINDENT
+				printf("Bound hit for all covers containing %d\n", curClause);
+			}
+		}
 
-			assert(!itCover->empty());
+		// try splitting on all covers containing the chosen clause
+		for (int itCover = coverNext[head()] ; itCover != head() && !childrenBounded ; itCover = coverNext[itCover]) {
 
-			if (itCover->find(curClause) != itCover->end()) {
-				// make copies of covers and clauses to be modified
-				list<Cover> newcovers = covers;
-				ClauseAssign newcurAssign = curAssign;
+			assert(!covers[itCover].empty());
 
-				// perform the modifications
-				removeClauseAndCover(newcovers, newcurAssign, curClause, *itCover);
+			if (covers[itCover].has(curClause)) {
+				// perform the modifications, remembering where to undo them to
+				unsigned int mark = trail.size();
+				removeClauseAndCover(curClause, itCover);
 
-				// now continue on with the altered copies of covers and clauses
+				// now continue on with the altered covers and clauses
+				// (or leave that to an idle thread)
 				depth++;
-				bool skipRemaining = constructMUS(newcovers, newcurAssign);
+				bool skipRemaining = false;
+				memoClause = curClause;
+				if (parallel != NULL && parallel->wantsWork()) {
+					parallel->give(saveState());
+				}
+				else {
+					skipRemaining = constructMUS();
+				}
 				depth--;
-				if (skipRemaining) { break; }
+
+				// and restore them (including the list of covers being iterated)
+				undo(mark);
+				if (skipRemaining) {
+					bumpActivity(curClause);
+					// (skipping the clause's other covers after a bound hit is only
+					// safe in the static order)
+					if (branching == BRANCH_STATIC || stopped())  break;
+				}
 			}
 		}
 
 		// remove the clause from the MUS
-		curAssign[curClause] = -1;
-		curAssign.numPos--;
-		curAssign.numNeg++;
+		assign(curClause, -1);
 
 		// continuing on, remove the clause to simplify things
 		// this imposes a lexicographic(ish) order
 		//  - it is impossible now to pass a clause to constructMUS (in clauses) that
 		//    has a lower number than one already included in the MUS under construction
 		// it also maintains an invariant that there are no singleton-covers
-		if (!removeClause(covers, curClause, curAssign)) {
+		if (!removeClause(curClause)) {
 			if(verbose) {
 				DEPTHINDENT
 				printf("<--constructMUS removeClause returned false for %d\n", curClause);
@@ -217,70 +705,196 @@ bool MUSbuilder::constructMUS(list<Cover> covers, ClauseAssign curAssign) {
 }
 
 
+// Remove a cover from the subproblem
+inline void MUSbuilder::removeCover(Num cover) {
+	coverNext[coverPrev[cover]] = coverNext[cover];
+	coverPrev[coverNext[cover]] = coverPrev[cover];
+	coverLive[cover] = 0;
+	numLive--;
+	const BitCover& c = covers[cover];
+	for (int clause = c.first() ; clause >= 0 ; clause = c.next(clause)) {
+		occurs[clause]--;
+	}
+
+	Change change = { COVER_REMOVED, cover, 0, 0, 0 };
+	trail.push_back(change);
+}
+
+// Remove clauses (the given bits of word w) from a (remaining) cover, if any
+// are in it
+inline bool MUSbuilder::removeFromCover(Num cover, unsigned int w, Word bits) {
+	bits = covers[cover].removeBits(w, bits);
+	if (bits == 0) { return false; }
+	for (Word rest = bits ; rest != 0 ; rest &= rest-1) {
+		occurs[w * BitCover::BITS + __builtin_ctzll(rest)]--;
+	}
+
+	Change c = { CLAUSES_REMOVED, cover, w, 0, bits };
+	trail.push_back(c);
+	return true;
+}
+
+// Set the value of a clause in curAssign (1 = in the MUS, -1 = not, 0 = undecided)
+inline void MUSbuilder::assign(Num clause, char value) {
+	char& cur = curAssign[clause];
+
+	Change c = { CLAUSE_ASSIGNED, 0, clause, cur, 0 };
+	trail.push_back(c);
+
+	if (cur == 1) { curAssign.numPos--; }
+	else if (cur == -1) { curAssign.numNeg--; }
+	updatePrint(clause, cur);
+	cur = value;
+	updatePrint(clause, cur);
+	if (cur == 1) { curAssign.numPos++; }
+	else if (cur == -1) { curAssign.numNeg++; }
+}
+
+// Undo the changes to the search state, last first, until only mark remain
+void MUSbuilder::undo(unsigned int mark) {
+	while (trail.size() > mark) {
+		const Change& c = trail.back();
+		switch (c.type) {
+			case COVER_REMOVED: {
+				// its neighbors are restored first, so they are the same as
+				// when it was removed
+				coverNext[coverPrev[c.cover]] = c.cover;
+				coverPrev[coverNext[c.cover]] = c.cover;
+				coverLive[c.cover] = 1;
+				numLive++;
+				const BitCover& cover = covers[c.cover];
+				for (int clause = cover.first() ; clause >= 0 ; clause = cover.next(clause)) {
+					occurs[clause]++;
+				}
+				break;
+			}
+			case CLAUSES_REMOVED:
+				covers[c.cover].restoreBits(c.index, c.bits);
+				for (Word rest = c.bits ; rest != 0 ; rest &= rest-1) {
+					occurs[c.index * BitCover::BITS + __builtin_ctzll(rest)]++;
+				}
+				break;
+			case CLAUSE_ASSIGNED: {
+				char& cur = curAssign[c.index];
+				if (cur == 1) { curAssign.numPos--; }
+				else if (cur == -1) { curAssign.numNeg--; }
+				updatePrint(c.index, cur);
+				cur = c.oldValue;
+				updatePrint(c.index, cur);
+				if (cur == 1) { curAssign.numPos++; }
+				else if (cur == -1) { curAssign.numNeg++; }
+				break;
+			}
+		}
+		trail.pop_back();
+	}
+}
+
+
 // Given a selected clause and a cover in which it appears:
 //  1) Remove all covers in which the given clause appears.
 //  2) Remove all other clauses in the given cover from the other covers.
-void MUSbuilder::removeClauseAndCover(list<Cover>& covers, ClauseAssign& curAssign, Num clause, const Cover& cover) {
+void MUSbuilder::removeClauseAndCover(Num clause, Num cover) {
 	if(verbose) {
 		DEPTHINDENT
 		printf("-->removeClauseAndCover   clause=%d cover=", clause);
-		for (Cover::iterator itClause = cover.begin() ; itClause != cover.end() ; itClause++) {
-			printf("%d ", *itClause);
+		for (int itClause = covers[cover].first() ; itClause >= 0 ; itClause = covers[cover].next(itClause)) {
+			printf("%d ", itClause);
 		}
 		printf("\n");
 	}
 
 	// remove all covers containing the given clause
-	for (list<Cover>::iterator itCover = covers.begin() ; itCover != covers.end() ; ) {
-		if (itCover->find(clause) != itCover->end())
-			itCover = covers.erase(itCover);
-		else
-			itCover++;
-	}
-
-	// setup the set of clauses to be removed from the problem (everything in
-	// the specified MCS (MUS cover) minus the chosen clause itself (we already
-	// removed all MCSes (MUS covers) containing that clause, so this might
-	// save a bit of time))
-	Cover removeClauses = cover;
-	removeClauses.erase(clause);
-
-	// remove the clauses from any covers that contain them
-	for (list<Cover>::iterator itCover = covers.begin() ; itCover != covers.end() ; ) {
-		Cover newCover;
+	// (the given cover is among them, so it is left untouched from here on)
+	collectCovers(clause);
+	for (vector<int>::iterator it = candidates.begin() ; it != candidates.end() ; it++) {
+		if (covers[*it].has(clause))
+			removeCover(*it);
+	}
 
-		set_difference(itCover->begin(),itCover->end() , removeClauses.begin(),removeClauses.end() , inserter(newCover,newCover.begin()));
-		if (newCover.size() != itCover->size()) {
-			assert(!newCover.empty());
+	// remove the clauses of the given cover (minus the chosen clause itself;
+	// we already removed all MCSes (MUS covers) containing that clause) from
+	// any covers that contain them
+	removeClauses = covers[cover];
+	removeClauses.removeBits(clause / BitCover::BITS, (Word)1 << (clause % BitCover::BITS));
+	collectCovers(removeClauses);
+	for (vector<int>::iterator it = candidates.begin() ; it != candidates.end() ; it++) {
+		int itCover = *it;
+		// (it may have been removed as a superset of one before it)
+		if (!coverLive[itCover])  continue;
+		bool removedSomething = false;
+		for (unsigned int w = 0 ; w < removeClauses.numWords() ; w++) {
+			if (removeClauses.word(w) != 0 && removeFromCover(itCover, w, removeClauses.word(w))) {
+				removedSomething = true;
+			}
+		}
+		if (removedSomething) {
+			assert(!covers[itCover].empty());
 
-			*itCover = newCover;
 			// if anything was removed, maintain the invariant that no cover
 			// may fully contain another - only need to check to see if the
 			// newly smaller cover is contained in anything else
-			maintainNoSubsets(covers, *itCover);
+			maintainNoSubsets(itCover);
+		}
+	}
 
+	// this will pick up on any removed clauses (some clauses may have only
+	// been in now-removed covers)
+	for (int i = curAssign.size() ; i-->0 ; ) {
+		if (curAssign[i] == 0 && occurs[i] == 0) {
+			assign(i, -1);
 		}
-		itCover++;
 	}
+}
 
-	// repopulate the set of clauses (some clauses may have only been in
-	// now-removed covers)
-	ClauseAssign remainingClauses;
-	remainingClauses.resize(curAssign.size(), 0);
-	for (list<Cover>::iterator itCover = covers.begin() ; itCover != covers.end() ; itCover++) {
-		assert(!itCover->empty());
-		for (Cover::iterator itClause = itCover->begin() ; itClause != itCover->end() ; itClause++) {
-			remainingClauses[*itClause] = 1;
+// Put in candidates the remaining covers that may contain the given clause,
+// in the order of the list of remaining covers
+inline void MUSbuilder::collectCovers(Num clause) {
+	candidates.clear();
+	const vector<int>& list = clauseCovers[clause];
+	if (2 * (int)list.size() < numLive) {
+		for (vector<int>::const_iterator it = list.begin() ; it != list.end() ; it++) {
+			if (coverLive[*it])  candidates.push_back(*it);
 		}
 	}
+	else {
+		for (int itCover = coverNext[head()] ; itCover != head() ; itCover = coverNext[itCover]) {
+			candidates.push_back(itCover);
+		}
+	}
+}
 
-	// this will pick up on any removed clauses
-	for (int i = curAssign.size() ; i-->0 ; ) {
-		if (curAssign[i] == 0 && !remainingClauses[i]) {
-			curAssign[i] = -1;
-			curAssign.numNeg++;
+// Put in candidates the remaining covers that contain any of the given
+// clauses (and maybe others), in the order of the list of remaining covers
+void MUSbuilder::collectCovers(const BitCover& clauses) {
+	candidates.clear();
+
+	int listed = 0;
+	for (int clause = clauses.first() ; clause >= 0 && 2 * listed < numLive ; clause = clauses.next(clause)) {
+		listed += clauseCovers[clause].size();
+	}
+	if (2 * listed >= numLive) {
+		for (int itCover = coverNext[head()] ; itCover != head() ; itCover = coverNext[itCover]) {
+			candidates.push_back(itCover);
+		}
+		return;
+	}
+
+	if (++markStamp == 0) {
+		coverMark.assign(coverMark.size(), 0);
+		markStamp = 1;
+	}
+	for (int clause = clauses.first() ; clause >= 0 ; clause = clauses.next(clause)) {
+		const vector<int>& list = clauseCovers[clause];
+		for (vector<int>::const_iterator it = list.begin() ; it != list.end() ; it++) {
+			if (coverLive[*it] && coverMark[*it] != markStamp && covers[*it].has(clause)) {
+				coverMark[*it] = markStamp;
+				candidates.push_back(*it);
+			}
 		}
 	}
+	// (the covers are never reordered, so that is by number)
+	sort(candidates.begin(), candidates.end());
 }
 
 // Propagate any singleton covers.
@@ -288,48 +902,49 @@ void MUSbuilder::removeClauseAndCover(list<Cover>& covers, ClauseAssign& curAssi
 // are propagated by this function.  If clause C5 becomes a singleton, for example,
 // it is automatically included in the growing MUS (curAssign) and removed from
 // the remaining subproblem (covers).
-inline void MUSbuilder::propagateSingletons(list<Cover>& covers, ClauseAssign& curAssign) {
-	for (list<Cover>::iterator itCover = covers.begin() ; itCover != covers.end() ; ) {
-		if (itCover->size() == 1) {
+inline void MUSbuilder::propagateSingletons() {
+	for (int itCover = coverNext[head()] ; itCover != head() ; itCover = coverNext[itCover]) {
+		if (covers[itCover].size() == 1) {
+			Num clause = covers[itCover].first();
 			if (verbose) {
 				DEPTHINDENT
-				printf("Propagation implies %d\n", *(itCover->begin()));
+				printf("Propagation implies %d\n", clause);
 			}
-			assert(curAssign[*(itCover->begin())] == 0);
-			curAssign[*(itCover->begin())] = 1;
-			curAssign.numPos++;
-			itCover = covers.erase(itCover);
-		}
-		else {
-			itCover++;
+			assert(curAssign[clause] == 0);
+			assign(clause, 1);
+			removeCover(itCover);
+			if (memo != NULL)  memo->addForced(memoStack.back(), clause);
 		}
 	}
 }
 
 // remove a clause from the covers, used after skipping a clause
 // this helps performance *immensely*
-inline bool MUSbuilder::removeClause(list<Cover>& covers, Num clause, ClauseAssign& assign) {
+inline bool MUSbuilder::removeClause(Num clause) {
 	if(verbose) {
 		DEPTHINDENT
 		printf("-->removeClause   clause=%d\n", clause);
 	}
 
 	// remove the clause from any covers that contain it
-	for (list<Cover>::iterator itCover = covers.begin() ; itCover != covers.end() ; ) {
+	collectCovers(clause);
+	for (vector<int>::iterator it = candidates.begin() ; it != candidates.end() ; it++) {
+		int itCover = *it;
+		// (it may have been removed as a superset of one before it)
+		if (!coverLive[itCover])  continue;
 
 		// If it was found (and removed):
-		if (itCover->erase(clause) > 0) {
+		if (removeFromCover(itCover, clause / BitCover::BITS, (Word)1 << (clause % BitCover::BITS))) {
 
 			// 1) return false immediately if the cover is now empty (clause
 			// was required)
-			if (itCover->empty()) return false;
+			if (covers[itCover].empty()) return false;
 
 			// 2) maintain the invariant that no cover may fully contain
 			// another only need to check to see if the newly smaller cover is
 			// contained in anything else
-			maintainNoSubsets(covers, *itCover);
+			maintainNoSubsets(itCover);
 		}
-		itCover++;
 	}
 
 	return true;
@@ -338,36 +953,183 @@ inline bool MUSbuilder::removeClause(list<Cover>& covers, Num clause, ClauseAssi
 // Maintain the invariant that no covers fully contain any others by removing
 // any that do.  Function takes a single cover as an input and assumes that it
 // is the only cover that could be violating the invariant
-inline void MUSbuilder::maintainNoSubsets(list<Cover>& covers, const Cover& modCover) {
-	for (list<Cover>::iterator itCover = covers.begin() ; itCover != covers.end() ; ) {
+inline void MUSbuilder::maintainNoSubsets(Num modCover) {
+	const BitCover& mod = covers[modCover];
+
+	// any cover including it is in the list of its rarest clause
+	int rarest = mod.first();
+	for (int clause = mod.next(rarest) ; clause >= 0 ; clause = mod.next(clause)) {
+		if (clauseCovers[clause].size() < clauseCovers[rarest].size()) { rarest = clause; }
+	}
+	const vector<int>& list = clauseCovers[rarest];
+	if (2 * (int)list.size() < numLive) {
+		for (vector<int>::const_iterator it = list.begin() ; it != list.end() ; it++) {
+			if (coverLive[*it] && mod.size() < covers[*it].size()
+				 && covers[*it].includes(mod))
+				removeCover(*it);
+		}
+		return;
+	}
+
+	for (int itCover = coverNext[head()] ; itCover != head() ; itCover = coverNext[itCover]) {
 		// 11/10/04 --- We could remove if they're equal, too, but it doesn't seem to help
-		//if (modCover.size() <= itCover->size() && modCover != *itCover
-		if (modCover.size() < itCover->size()
-			 && includes(itCover->begin(),itCover->end() , modCover.begin(),modCover.end()))
-			itCover = covers.erase(itCover);
-		else
-			itCover++;
+		//if (mod.size() <= covers[itCover].size() && mod != covers[itCover]
+		if (mod.size() < covers[itCover].size()
+			 && covers[itCover].includes(mod))
+			removeCover(itCover);
 	}
 }
 
-// Check to see if we've visited this assignment before using the beenHere hash set
-inline bool MUSbuilder::isVisited(const ClauseAssign& curAssign) {
-	return !beenHere.insert(curAssign).second;
+// Check to see if we've visited this assignment before using the beenHere
+// (or, for a node with no covers left, musesSeen) table
+inline bool MUSbuilder::isVisited(bool isMUS) {
+	if (memo != NULL) {
+		return isMUS && musesSeen.insert(positivePrint());
+	}
+	if (parallel != NULL) {
+		return isMUS ? parallel->musesSeen.insert(curPrint) : parallel->beenHere.insert(curPrint);
+	}
+	return isMUS ? musesSeen.insert(curPrint) : beenHere.insert(curPrint);
 }
 
-inline void MUSbuilder::outputMUS(ClauseAssign& curAssign) {
-	if (reportEachTime) {
-		printf("%Ld: ", (long long)(time(NULL)));
+// Report the use of the visited-node tables
+void MUSbuilder::printStats(FILE* out) {
+	if (parallel != NULL) {
+		printStats(out, parallel->beenHere, parallel->musesSeen);
+		fprintf(out, "Parallel search: %d threads, %llu tasks\n", numThreads, parallel->tasksRun);
 	}
+	else {
+		printStats(out, beenHere, musesSeen);
+	}
+	if (doBB) {
+		fprintf(out, "Branch-and-bound: %llu nodes cut off by the bound\n", boundHits);
+	}
+	if (memo != NULL) {
+		fprintf(out, "Memo: %llu lookups, %llu hits (%.1f%%), %llu MUSes output from it, %lu results cached (%.1f MB), %llu evicted, %llu incomplete\n",
+			memo->lookups, memo->hits, memo->lookups ? 100.0 * memo->hits / memo->lookups : 0.0,
+			memo->replayed, (unsigned long)memo->size(), memo->getBytes() / 1048576.0,
+			memo->evicted, memo->incomplete);
+	}
+}
 
-	printf(singletonsStr.c_str());
+template<class Table>
+void MUSbuilder::printStats(FILE* out, const Table& beenHere, const Table& musesSeen) {
+	unsigned long long lookups = beenHere.getLookups() + musesSeen.getLookups();
+	unsigned long long hits = beenHere.getHits() + musesSeen.getHits();
+	fprintf(out, "Visited nodes: %llu lookups, %llu hits (%.1f%%), %lu stored (%.1f MB)%s, %lu MUS nodes stored\n",
+		lookups, hits, lookups ? 100.0 * hits / lookups : 0.0,
+		(unsigned long)beenHere.size(), beenHere.bytes() / 1048576.0,
+		beenHere.isFull() ? ", table full" : "",
+		(unsigned long)musesSeen.size());
+}
+
+// do with the MUS at the current node whatever the search calls for
+inline void MUSbuilder::foundMUS() {
+	if (curAssign.numPos < minSize) {
+		// (already output by an earlier search of the iterative deepening)
+		return;
+	}
+
+	if (topK > 0 && !sizeOrder) {
+		keepBest();
+		return;
+	}
+
+	if (doBB && maxSize < 0 && !sizeOrder) {
+		// just looking for a smaller one than the last
+		if (parallel != NULL) {
+			// print it at once, but only if no other thread has found one
+			// at least as small in the meantime
+			pthread_mutex_lock(&parallel->outputLock);
+			if (curAssign.numPos < parallel->bbUpper) {
+				string mus;
+				formatMUS(mus);
+				fputs(mus.c_str(), stdout);
+				atomicSet(parallel->bbUpper, curAssign.numPos);
+			}
+			pthread_mutex_unlock(&parallel->outputLock);
+		}
+		else {
+			outputMUS();
+		}
+		bbUpper = curAssign.numPos;
+		return;
+	}
+
+	if (topK > 0) {
+		// output in size order, so the first topK are the smallest
+		int n;
+		if (parallel != NULL) {
+			pthread_mutex_lock(&parallel->outputLock);
+			n = ++parallel->owner->numOutput;
+			pthread_mutex_unlock(&parallel->outputLock);
+		}
+		else {
+			n = ++numOutput;
+		}
+		if (n > topK) { return; }
+		if (n == topK) { stopSearch(); }
+	}
+	outputMUS();
+}
+
+// Keep the MUS at the current node if it is among the topK smallest found
+// so far (in the kBest of the original MUSbuilder, with several threads)
+inline void MUSbuilder::keepBest() {
+	string mus;
+	formatMUS(mus);
+
+	if (parallel != NULL) { pthread_mutex_lock(&parallel->outputLock); }
+	vector< pair<int,string> >& best = (parallel != NULL) ? parallel->owner->kBest : kBest;
+	if ((int)best.size() < topK || curAssign.numPos < best.front().first) {
+		best.push_back(make_pair(curAssign.numPos, mus));
+		push_heap(best.begin(), best.end());
+		if ((int)best.size() > topK) {
+			pop_heap(best.begin(), best.end());
+			best.pop_back();
+		}
+		if ((int)best.size() == topK) {
+			// from now on, only smaller MUSes than the largest kept will do
+			bbUpper = best.front().first;
+			if (parallel != NULL) { atomicSet(parallel->bbUpper, bbUpper); }
+		}
+	}
+	if (parallel != NULL) { pthread_mutex_unlock(&parallel->outputLock); }
+}
+
+// End the search early (all wanted MUSes are output): with an upper bound of
+// 0, every node is cut off.
+void MUSbuilder::stopSearch() {
+	bbUpper = 0;
+	if (parallel != NULL) { atomicSet(parallel->bbUpper, 0); }
+}
+
+inline void MUSbuilder::outputMUS() {
+	formatMUS(outBuf);
+	if (parallel == NULL || outBuf.size() >= OUTPUT_BUFFER_SIZE) {
+		flushOutput();
+	}
+}
+
+// write out the MUSes collected in outBuf
+void MUSbuilder::flushOutput() {
+	if (outBuf.empty()) { return; }
+	if (parallel != NULL) { pthread_mutex_lock(&parallel->outputLock); }
+	fputs(outBuf.c_str(), stdout);
+	if (parallel != NULL) { pthread_mutex_unlock(&parallel->outputLock); }
+	outBuf.clear();
+}
+
+// append the current MUS (one line) to out
+void MUSbuilder::formatMUS(string& out) {
+	startMUS(out);
 
 	for (Num i = 0 ; i < curAssign.size() ; i++) {
 		if (curAssign[i] == 1) { 
-			printf("%d ", mapToOrig(i)); 
+			appendClause(out, i);
 		}
 	}
-	printf("\n");
+	out += '\n';
 
 	// Alternate printing method:
 	// sorting is only needed for making the output nice, and even then only if
@@ -392,44 +1154,113 @@ inline void MUSbuilder::outputMUS(ClauseAssign& curAssign) {
 // set of the remaining MCSes.  Used only in branch-and-bound search.
 // MIS = Maximal Independent Set.  The number of independent sets found is a
 // lower bound on the number of elements needed to hit all sets.
-// NOTE: This destroys the working dataset - hence passing by copy
-inline int MUSbuilder::mis_quick(list<Cover> covers) {
+// Works on a list of the remaining covers' indexes, leaving the state alone.
+inline int MUSbuilder::mis_quick() {
 	int result = 0;
 
+	misCovers.clear();
+	clauseLoad.assign(curAssign.size(), 0.0);
+	for (int itCover = coverNext[head()] ; itCover != head() ; itCover = coverNext[itCover]) {
+		misCovers.push_back(itCover);
+	}
+
 	// loop until we're out of covers (all removed by dependence on others)
-	while (!covers.empty()) {
-		int minLength = 1<<30;
-		int curLength = 0;
-		Cover removeMCS;
+	while (!misCovers.empty()) {
+		unsigned int minLength = 1<<30;
+		int removeMCS = -1;
 
 		// loop through the current set of covers, keeping track of the shortest
-		for (list<Cover>::iterator it = covers.begin() ; it != covers.end() ; it++) {
-			curLength = it->size();
-			if (curLength < minLength) {
-				minLength = curLength;
-				// copy it into removeMCS
+		for (vector<int>::iterator it = misCovers.begin() ; it != misCovers.end() ; it++) {
+			if (covers[*it].size() < minLength) {
+				minLength = covers[*it].size();
 				removeMCS = *it;
 			}
 		}
 
 		// found a new MCS 
 		result++;
+		const BitCover& mcs = covers[removeMCS];
+		for (int clause = mcs.first() ; clause >= 0 ; clause = mcs.next(clause)) {
+			clauseLoad[clause] = 1;
+		}
 
 		// remove intersecting covers (including the newly found cover)
-		for (list<Cover>::iterator it = covers.begin() ; it != covers.end() ; ) {
-			bool removedSomething = false;
-			for (Cover::iterator it2 = removeMCS.begin() ; it2 != removeMCS.end() ; it2++) {
-				if (it->find(*it2) != it->end()) {
-					removedSomething = true;
-					it = covers.erase(it);
-					break;
-				}
-			}
-			// nothing erased, so need to increment iterator
-			if (!removedSomething) it++;
+		vector<int>::iterator keep = misCovers.begin();
+		for (vector<int>::iterator it = misCovers.begin() ; it != misCovers.end() ; it++) {
+			if (!covers[*it].intersects(mcs)) { *keep++ = *it; }
 		}
+		misCovers.erase(keep, misCovers.end());
 	}
 
 	return result;
 }
 
+// Lower bound on the size of the smallest hitting set of the remaining covers
+// (before rounding up)
+inline double MUSbuilder::lowerBound() {
+	double disjoint = mis_quick();
+	if (bbBound == BOUND_DISJOINT) { return disjoint; }
+
+	// neither is always the stronger, so keep the better
+	disjointLoad.swap(clauseLoad);
+	double dual = dualAscent();
+	if (dual >= disjoint) { return dual; }
+	clauseLoad.swap(disjointLoad);
+	return disjoint;
+}
+
+// Dual ascent: raise the weights of all remaining covers at the same rate
+// until some clause's load reaches 1, then go on with the covers that do not
+// contain any such (saturated) clause, until none are left.  Where covers
+// overlap a lot, this sums to more than any set of disjoint covers does (for
+// {1,2},{2,3},{1,3}, 3/2 rather than 1).
+inline double MUSbuilder::dualAscent() {
+	double total = 0;
+
+	// the raised covers, and the number of them containing each clause
+	misCovers.clear();
+	clauseLoad.assign(curAssign.size(), 0.0);
+	clauseRaised.assign(curAssign.size(), 0);
+	for (int itCover = coverNext[head()] ; itCover != head() ; itCover = coverNext[itCover]) {
+		misCovers.push_back(itCover);
+		const BitCover& c = covers[itCover];
+		for (int clause = c.first() ; clause >= 0 ; clause = c.next(clause)) {
+			clauseRaised[clause]++;
+		}
+	}
+
+	while (!misCovers.empty()) {
+		// raise until the next clause is saturated
+		double step = 1;
+		for (unsigned int clause = 0 ; clause < clauseLoad.size() ; clause++) {
+			if (clauseRaised[clause] > 0) {
+				step = min(step, (1 - clauseLoad[clause]) / clauseRaised[clause]);
+			}
+		}
+		total += step * misCovers.size();
+		for (unsigned int clause = 0 ; clause < clauseLoad.size() ; clause++) {
+			clauseLoad[clause] += step * clauseRaised[clause];
+		}
+
+		// and stop raising the covers containing a saturated clause
+		vector<int>::iterator keep = misCovers.begin();
+		for (vector<int>::iterator it = misCovers.begin() ; it != misCovers.end() ; it++) {
+			const BitCover& c = covers[*it];
+			bool saturated = false;
+			for (int clause = c.first() ; clause >= 0 && !saturated ; clause = c.next(clause)) {
+				saturated = (clauseLoad[clause] > 1 - 1e-9);
+			}
+			if (saturated) {
+				for (int clause = c.first() ; clause >= 0 ; clause = c.next(clause)) {
+					clauseRaised[clause]--;
+				}
+			}
+			else {
+				*keep++ = *it;
+			}
+		}
+		misCovers.erase(keep, misCovers.end());
+	}
+
+	return total;
+}
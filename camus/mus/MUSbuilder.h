@@ -12,147 +12,272 @@
 #ifndef MUSBUILDER_H
 #define MUSBUILDER_H
 
-#include <list>
-#include <set>
-
-#include <hash_set>
-#include <hash_map>
-
 #include <vector>
 #include <algorithm>
 
 #include <limits>
-#include <time.h>
-#include <stdio.h>
-#include <sstream>
-
-using namespace::std;
-
-#define foreach(x,y,z)  for (x::iterator (y) = (z).begin() ; (y) != (z).end() ; (y)++)
-
-typedef unsigned int Num;
-typedef std::set<Num>  Cover;
-
-#ifdef USING_STLPORT
-typedef hash_map<Num,int> ClauseMap;
-#else
-typedef __gnu_cxx::hash_map<Num,int> ClauseMap;
-#endif
-
-//typedef vector<char>  ClauseAssign;
-class ClauseAssign : public vector<char> {
-public:
-	int numPos, numNeg;
-	ClauseAssign() : numPos(0), numNeg(0) {}
+#include <signal.h>
+
+#include "hsengine.h"
+#include "bitcover.h"
+#include "visited.h"
+#include "memo.h"
+
+// A node of the search to be explored from scratch (by another thread): its
+// remaining covers (in order) and its assignment
+struct SearchTask {
+	vector<BitCover> covers;
+	ClauseAssign assign;
+	unsigned int depth;
 };
 
+// State shared by the threads of a parallel search (defined in MUSbuilder.cpp)
+struct ParallelSearch;
 
-// A simple hashing function (for building a hash table of ClauseAssign objects)
-struct hashAssign {
-	inline size_t operator()(const ClauseAssign& s) const {
-		size_t h = 0;
-		for (ClauseAssign::const_iterator it = s.begin() ; it != s.end() ; it++) {
-			// Thanks to Steven Hayman
-			//  (who won a hash-function competition in my algorithms class)
-			h = 7 * (h + *it);
-		}
-		return h;
-	}
-};
-
-// Equality operator used to compare two ClauseAssign objects
-struct eqAssign {
-  inline bool operator()(const ClauseAssign& s1, const ClauseAssign& s2) const {
-	// assumes they're the same length (safe *only* in this application)
-	for (unsigned int i = 0 ; i < s1.size() ; i++) {
-		if (s1[i] != s2[i]) {
-			return false;
-		}
-	}
-	return true;
-  }
-};
 
-class MUSbuilder {
+class MUSbuilder : public HSEngine {
 private:
 	unsigned int depth;
-	bool verbose;
-	bool reportEachTime;
 
 	// Use branch-and-bound (BB) to find the smallest MUS
 	bool doBB;
 	// Upper bound used in the branch-and-bound search
 	int bbUpper;
-
-	// Singleton MCSes are clauses that will be contained in every MUS;
-	// therefore, we need not involve them in any computations.  We store
-	// them in a vector and create a string *once*, to print at the beginning
-	// of every output MUS, containing the clauses indicated by singleton MCSes.
-	vector<Num> singletons;
-	string singletonsStr;
-
-	// beenHere is a hash set storing the ClauseAssign objects for any nodes
-	// we have already visited.  Used to avoid redundant work.
-	// Defined by the object type stored (ClauseAssign),
-	// hashing function (hashAssign), and equality operator (eqAssign).
-#ifdef USING_STLPORT
-	hash_set< ClauseAssign , hashAssign , eqAssign > beenHere;
-#else
-	__gnu_cxx::hash_set< ClauseAssign , hashAssign , eqAssign > beenHere;
-#endif
-
-	ClauseMap clauseMappingRev;	// new to original numbers
-
-	inline int mapToOrig(Num clause) {
-		return clauseMappingRev[clause];
+	// Lower bound used in the branch-and-bound search (see lowerBound())
+	int bbBound;
+
+	// The branch-and-bound search can also find the topK smallest MUSes
+	// (kept in kBest, a max-heap by size, until the end), or every MUS of at
+	// most maxSize clauses.  With sizeOrder, MUSes are found by iterative
+	// deepening instead: one search per size, each outputting only the MUSes
+	// of that size (minSize), so they come out smallest first.  Sizes count
+	// only the clauses in covers (not the singletons), except maxSize.
+	int topK;				// 0 = no limit
+	int maxSize;			// -1 = no limit
+	bool sizeOrder;
+	int minSize;
+	int numOutput;
+	vector< pair<int,string> > kBest;
+	unsigned long long boundHits;	// nodes cut off by the bound
+	inline void foundMUS();
+	inline void keepBest();
+	void stopSearch();
+	bool constructMUSBySize(const vector<BitCover>& rootCovers, const ClauseAssign& assign);
+
+	// How constructMUS() picks the clause to branch on next (setBranching()):
+	// by clause number (which generateMappingSorted() orders by the number of
+	// covers each clause is in at the root), or by the current covers, with
+	// ties broken by activity, which is raised for the clauses whose
+	// children were cut off by the bound.
+	int branching;
+	vector<double> activity;
+	double activityInc;
+	inline int chooseClause(unsigned int& next);
+	inline void bumpActivity(Num clause);
+
+	// Set (from a signal handler) to stop a search with one thread
+	volatile sig_atomic_t stopRequested;
+	inline bool stopped();
+
+	// beenHere stores a fingerprint of the ClauseAssign for any nodes we have
+	// already visited.  Used to avoid redundant work.  It may be limited in
+	// size, so the nodes at which MUSes are output are kept separately in
+	// musesSeen, which is not: that alone keeps the output free of duplicates.
+	VisitedTable beenHere;
+	VisitedTable musesSeen;
+	size_t maxVisitedBytes;
+
+	// With more than one thread, each thread searches with its own copy of
+	// this object, and they all share parallel (owned by the original).
+	int numThreads;
+	ParallelSearch* parallel;
+	string outBuf;		// MUSes not yet written to stdout
+	static void* worker(void* arg);
+	void runTasks();
+	bool constructMUSParallel(const vector<BitCover>& rootCovers, const ClauseAssign& assign);
+	bool search(const vector<BitCover>& rootCovers, const ClauseAssign& assign);
+	void flushOutput();
+	template<class Table>
+	void printStats(FILE* out, const Table& beenHere, const Table& musesSeen);
+
+	// The fingerprint of curAssign is the XOR of a random key for each
+	// clause's value (Zobrist hashing), so assign() and undo() keep it up to
+	// date in constant time.  zobrist[2*i] is for clause i = 1, [2*i+1] for -1.
+	vector<Fingerprint> zobrist;
+	Fingerprint curPrint;
+	inline void updatePrint(Num clause, char value) {
+		if (value != 0) { curPrint ^= zobrist[2*clause + (value < 0)]; }
 	}
-	inline void outputMUS(ClauseAssign& curAssign);
+
+	inline void outputMUS();
+	void formatMUS(string& out);
+
+	// With memo (setMemoBytes()), the result of searching each subproblem (the
+	// remaining covers, whatever the assignment) is cached by a fingerprint
+	// of its covers, and a node whose subproblem was searched before just
+	// outputs its context with each completion found then, instead of
+	// searching it again.  memoStack holds the results being recorded, for
+	// the nodes on the current path, and memoClause the clause each child
+	// added.  Only for plain enumeration (no bound) with one thread; the
+	// cache then replaces beenHere, and MUSes are told apart by their
+	// clauses alone.
+	MemoTable* memo;
+	vector<MemoEntry*> memoStack;
+	Num memoClause;
+	vector<Num> replayPath;
+	Fingerprint coversKey();
+	Fingerprint positivePrint();
+	void replay(const MemoEntry* e, const Fingerprint& print);
+	void outputReplayed(const Fingerprint& print);
+
+	// The search state: the remaining subproblem and the MUS under
+	// construction.  Every node works on this one copy in place; each change
+	// is recorded on the trail so that undo() can restore the state of an
+	// earlier node in time proportional to the changes made since.
+	vector<BitCover> covers;		// every cover, removed or not
+	vector<int> coverNext;			// doubly-linked list of the covers still in the
+	vector<int> coverPrev;			//   subproblem; index covers.size() is the head
+	vector<int> occurs;				// number of remaining covers containing each clause
+	vector<char> coverLive;			// is each cover still in the subproblem?
+	int numLive;
+	ClauseAssign curAssign;
+
+	// For each clause, the covers that contained it when the state was
+	// loaded, in order.  Covers only lose clauses, so these include every
+	// remaining cover that contains it, and the covers that include a given
+	// one are all in the list of its rarest clause.  The lists are only
+	// used where they are less than half as long as the list of remaining
+	// covers (they may hold many removed covers deep in the search).
+	vector< vector<int> > clauseCovers;
+	vector<int> candidates;
+	vector<unsigned int> coverMark;
+	unsigned int markStamp;
+	inline void collectCovers(Num clause);
+	void collectCovers(const BitCover& clauses);
+
+	enum ChangeType { COVER_REMOVED, CLAUSES_REMOVED, CLAUSE_ASSIGNED };
+	struct Change {
+		ChangeType type;
+		Num cover;
+		Num index;		// clause assigned, or word of the cover clauses were removed from
+		char oldValue;
+		Word bits;		// clauses removed from that word
+	};
+	vector<Change> trail;
+
+	void loadState(const vector<BitCover>& newCovers, const ClauseAssign& assign);
+	SearchTask* saveState();
+	inline int head() { return covers.size(); }
+	inline void removeCover(Num cover);
+	inline bool removeFromCover(Num cover, unsigned int w, Word bits);
+	inline void assign(Num clause, char value);
+	void undo(unsigned int mark);
+
+	// Scratch space for removeClauseAndCover(), mis_quick(), and dualAscent()
+	BitCover removeClauses;
+	vector<int> misCovers;
+	vector<double> clauseLoad;
+	vector<int> clauseRaised;
+	vector<double> disjointLoad;
+
+	// The main, recursive function, working on the search state: it looks
+	// the node up in the memo, if any, and otherwise expands it
+	bool constructMUS();
+	bool expandNode();
 
 	// Given a selected clause and a cover in which it appears:
 	//  1) Remove all covers in which the given clause appears.
 	//  2) Remove all other clauses in the given cover from the other covers.
-	void removeClauseAndCover(list<Cover>& covers, ClauseAssign& curAssign, Num clause, const Cover& cover);
+	void removeClauseAndCover(Num clause, Num cover);
 
 	// Remove a clause from the covers, used after skipping a clause.
 	// This helps performance *immensely*.
-	inline bool removeClause(list<Cover>& covers, Num clause, ClauseAssign& assign);
+	inline bool removeClause(Num clause);
 
-	// Check to see if we've visited this assignment before using the beenHere hash set
-	inline bool isVisited(const ClauseAssign& curAssign);
+	// Check to see if we've visited this assignment before using the beenHere
+	// (or, for a node with no covers left, musesSeen) table
+	inline bool isVisited(bool isMUS);
 
 	// Maintain the invariant that no covers fully contain any others by removing
 	// any that do.  Function takes a single cover as an input and assumes that it
 	// is the only cover that could be violating the invariant
-	inline void maintainNoSubsets(list<Cover>& covers, const Cover& modCover);
+	inline void maintainNoSubsets(Num modCover);
 
 	// Propagate any singleton covers.
 	// Any singletons in the current subproblem (induced by removing clauses)
 	// are propagated by this function.  If clause C5 becomes a singleton, for example,
 	// it is automatically included in the growing MUS (curAssign) and removed from
 	// the remaining subproblem (covers).
-	inline void propagateSingletons(list<Cover>& covers, ClauseAssign& curAssign);
+	inline void propagateSingletons();
 
 	// Heuristic used to estimate (lower bound) the size of the smallest hitting
 	// set of the remaining MCSes.  Used only in branch-and-bound search.
 	// MIS = Maximal Independent Set.  The number of independent sets found is a
 	// lower bound on the number of elements needed to hit all sets.
-	// NOTE: This destroys the working dataset - hence passing by copy
-	inline int mis_quick(list<Cover> covers);
+	inline int mis_quick();
+
+	// Lower bounds for the branch-and-bound search come from weights on the
+	// remaining covers such that the covers containing any one clause weigh
+	// at most 1 in all: a solution to the dual of the LP relaxation of the
+	// hitting set problem, so any hitting set has at least (the sum of the
+	// weights) elements.  mis_quick() gives disjoint covers weight 1, and
+	// dualAscent() gives fractional weights.  Either leaves the load of each
+	// clause (the weight of the covers containing it) in clauseLoad, and
+	// lowerBound() returns the sum of the weights.
+	// The weights stay a solution in any child node (covers only lose
+	// clauses, and a cover removed for containing a smaller one can hand
+	// its weight to that one), except for the covers containing the clause
+	// added to the MUS, so constructMUS() can rule out a child before
+	// building it.
+	inline double lowerBound();
+	inline double dualAscent();
 
 
 public:
 	MUSbuilder() :
 		depth(0),
-		verbose(false),
-		reportEachTime(false),
 		doBB(false),
 		bbUpper(std::numeric_limits<int>::max()),
-		singletonsStr("")
+		bbBound(BOUND_DUAL),
+		topK(0),
+		maxSize(-1),
+		sizeOrder(false),
+		minSize(0),
+		numOutput(0),
+		boundHits(0),
+		branching(BRANCH_STATIC),
+		activityInc(1),
+		stopRequested(0),
+		maxVisitedBytes(0),
+		numThreads(1),
+		parallel(NULL),
+		memo(NULL),
+		memoClause(0),
+		numLive(0),
+		markStamp(0)
 	{ }
+	~MUSbuilder();
 
-	void setVerbose(bool b)			{ verbose = b; }
-	void setReportEachTime(bool b)	{ reportEachTime = b; }
 	void setDoBB(bool b)			{ doBB = b; }
+	enum { BOUND_DISJOINT, BOUND_DUAL };
+	void setBound(int b)			{ bbBound = b; }
+	void setTopK(int k)				{ topK = k; }
+	void setMaxSize(int n)			{ maxSize = n; }
+	void setSizeOrder(bool b)		{ sizeOrder = b; }
+	enum { BRANCH_STATIC, BRANCH_FEWEST, BRANCH_MOST, BRANCH_SMALLEST_COVER };
+	void setBranching(int b)		{ branching = b; }
+	void setMaxVisitedBytes(size_t b)	{ maxVisitedBytes = b; beenHere.setMaxBytes(b); }
+	void setNumThreads(int n)		{ numThreads = n; }
+	void setMemoBytes(size_t b)		{ delete memo; memo = new MemoTable(b); }
+
+	// Stop the search early (from a signal handler): constructMUS() returns
+	// soon after (having output the smallest MUSes found so far, with
+	// setTopK()) with wasInterrupted() true.
+	bool interrupt();
+	bool wasInterrupted();
+
+	// Report the use of the visited-node tables (and the memo)
+	void printStats(FILE* out);
 
 	// Utility function:
 	// Generate a mapping of clause names to numbers.  This ends up being a
@@ -166,27 +291,9 @@ public:
 	// Translate clauses based on the mapping generated by generateMapping*().
 	static void translateClauses(list<Cover>& MUSCovers, ClauseMap& clauseMapping);
 
-	// Add a clause mapping (from new clause IDs to original clause indexes)
-	void addClauseMapping(ClauseMap& newClauseMappingRev) {
-		clauseMappingRev = newClauseMappingRev;
-	}
-
-	// Pass singletons into this MUSbuilder object
-	// Creates the string used to output them (to be reused instead of
-	// recreated each time it's needed).
-	void addSingletons(vector<Num>& newSingletons) {
-		if (newSingletons.empty()) {return;}
-		singletons = newSingletons;
-		// make a string of it, too -- to save time when outputting
-		ostringstream o;
-		foreach(vector<Num>, it, singletons) {
-			o << *it << " ";
-		}
-		singletonsStr = o.str();
-	}
-
-	// The main, recursive function
-	bool constructMUS(list<Cover> covers, ClauseAssign curAssign);
+	// Construct all MUSes (or the smallest, with branch-and-bound) from the
+	// given covers, starting from the given (partial) assignment
+	bool constructMUS(const list<Cover>& MUSCovers, const ClauseAssign& assign);
 
 };
 
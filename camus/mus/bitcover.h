@@ -0,0 +1,97 @@
+/*
+ *  bitcover.h  -  A set of (compressed) clause numbers stored as a bitset,
+ *  used for the covers during the search in MUSbuilder
+ *
+ * Copyright (C) 2009, The Regents of the University of Michigan
+ * See the LICENSE file for details.
+ *
+ */
+
+#ifndef BITCOVER_H
+#define BITCOVER_H
+
+#include <vector>
+#include <set>
+
+typedef unsigned long long Word;
+
+// Clause numbers are compressed to 0..n-1 (see generateMapping*()), so a
+// cover is a bitset of n bits.  Subset, intersection, and difference tests
+// are then loops over whole words (which the compiler can vectorize), and
+// membership is a single bit test.  The number of elements is kept up to date.
+class BitCover {
+private:
+	std::vector<Word> words;
+	unsigned int count;
+
+public:
+	static const int BITS = 64;
+
+	BitCover() : count(0) {}
+	BitCover(const std::set<unsigned int>& clauses, unsigned int numBits) :
+		words((numBits + BITS-1) / BITS, 0),
+		count(0)
+	{
+		for (std::set<unsigned int>::const_iterator it = clauses.begin() ; it != clauses.end() ; it++) {
+			add(*it);
+		}
+	}
+
+	inline unsigned int size() const { return count; }
+	inline bool empty() const { return count == 0; }
+	inline unsigned int numWords() const { return words.size(); }
+	inline Word word(unsigned int w) const { return words[w]; }
+
+	inline bool has(unsigned int i) const {
+		return (words[i / BITS] >> (i % BITS)) & 1;
+	}
+	inline void add(unsigned int i) {
+		if (!has(i)) {
+			words[i / BITS] |= (Word)1 << (i % BITS);
+			count++;
+		}
+	}
+
+	// Remove the given bits from word w, returning those that were set
+	inline Word removeBits(unsigned int w, Word bits) {
+		bits &= words[w];
+		words[w] &= ~bits;
+		count -= __builtin_popcountll(bits);
+		return bits;
+	}
+	// Put back bits returned by removeBits()
+	inline void restoreBits(unsigned int w, Word bits) {
+		words[w] |= bits;
+		count += __builtin_popcountll(bits);
+	}
+
+	// Does this contain every element of other?
+	inline bool includes(const BitCover& other) const {
+		for (unsigned int w = 0 ; w < words.size() ; w++) {
+			if (other.words[w] & ~words[w])  return false;
+		}
+		return true;
+	}
+	inline bool intersects(const BitCover& other) const {
+		for (unsigned int w = 0 ; w < words.size() ; w++) {
+			if (other.words[w] & words[w])  return true;
+		}
+		return false;
+	}
+
+	// Iterate over the elements with:
+	//   for (int i = c.first() ; i >= 0 ; i = c.next(i))
+	inline int first() const { return next(-1); }
+	inline int next(int i) const {
+		unsigned int w = (i+1) / BITS;
+		if (w >= words.size())  return -1;
+		Word rest = words[w] & (~(Word)0 << ((i+1) % BITS));
+		while (rest == 0) {
+			if (++w == words.size())  return -1;
+			rest = words[w];
+		}
+		return w * BITS + __builtin_ctzll(rest);
+	}
+};
+
+#endif
@@ -21,6 +21,7 @@
 #include <vector>
 #include <unistd.h>
 #include "MUSbuilder.h"
+#include "MMCSbuilder.h"
 
 using namespace::std;
 
@@ -31,6 +32,8 @@ static struct rusage ruse;
 
 
 // Read the covers into a list of sets
+// A line starting with '-' retracts an earlier cover (camus_mcs -r prints
+// these when a streamed PCS is later subsumed by another).
 void parseCovers(istream& coversIn, list< Cover >& MUSCovers, vector<Num>& singletons) {
 	if (coversIn.fail()) fprintf(stderr, "ERROR! Could not open file.\n"), exit(1);
 
@@ -39,10 +42,20 @@ void parseCovers(istream& coversIn, list< Cover >& MUSCovers, vector<Num>& singl
 		istringstream istr(line);
 		Cover newCover;
 		Num clause;
+
+		istr >> std::ws;
+		bool retract = (istr.peek() == '-');
+		if (retract)  istr.get();
+
 		while (istr >> clause) {
 			newCover.insert(clause);
 		}
 		if (newCover.size() < 1) {continue;}  // empty line, most likely
+		if (retract) {
+			list<Cover>::iterator it = find(MUSCovers.begin(), MUSCovers.end(), newCover);
+			if (it != MUSCovers.end())  MUSCovers.erase(it);
+			continue;
+		}
 		if (newCover.size() == 1) { singletons.push_back(clause); }
 		else { MUSCovers.push_back(newCover); }
 	}
@@ -61,40 +74,132 @@ static void pusage() {
 	<< "  -v      : verbose" << endl
 	<< "  -s      : report stats (runtime to STDERR)" << endl
 	<< "  -T      : report a timestamp for every result (for producing anytime graphs)" << endl
+	<< "  -E n    : algorithm: 0 = cover splitting (default), 1 = MMCS minimal hitting sets" << endl
+	<< "            (-b, -B, -k, -u, -o, -H, -m, -j, and -D apply only to cover splitting)" << endl
 	<< "  -b      : use branch-and-bound to find a minimum-cardinality result" << endl
+	<< "  -B n    : lower bound for -b, -k, -u, and -o: 0 = disjoint covers, 1 = LP dual (default)" << endl
+	<< "  -k n    : output only the n smallest MUSes (smallest first)" << endl
+	<< "  -u n    : output only the MUSes of at most n clauses" << endl
+	<< "  -o      : output MUSes smallest first (searching for each size in turn)" << endl
+	<< "  -H n    : branch on: 0 = clauses in order of their number of MCSes (default)," << endl
+	<< "            1 = the clause in the fewest remaining MCSes, 2 = in the most," << endl
+	<< "            3 = a clause of the smallest remaining MCS" << endl
+	<< "  -S      : report search statistics, such as the use of the table of visited" << endl
+	<< "            search nodes (to STDERR)" << endl
+	<< "  -m n    : limit the table of visited search nodes to about n MB" << endl
+	<< "  -j n    : search with n threads (0 = one per CPU); MUSes are output in no fixed order" << endl
+	<< "  -D n    : cache the results of search subproblems, in about n MB, to reuse them" << endl
+	<< "            (not with -b, -k, -u, -o, or -j)" << endl
 	<< "  -t n    : set an n second timeout" << endl
 	<< endl;
 	exit(1);
 }
 
 // SIGALRM handler
-void alarm_handler(int sig) { cerr << "Timeout reached." << endl; exit(1); }
+static HSEngine* theBuilder = NULL;
+static bool reportStats = false;	// -S
+void alarm_handler(int sig) {
+	// a parallel search stops itself (so that its output is complete), and
+	// main() reports the timeout
+	if (theBuilder != NULL && theBuilder->interrupt())  return;
+
+	cerr << "Timeout reached." << endl;
+	if (reportStats)  theBuilder->printStats(stderr);
+	exit(1);
+}
 
 
 
 int main(int argc, char** argv) {
 	double cpu_time = CPUTIME;
-	MUSbuilder builder;
 	bool reportTime = false;
 
+	// settings for the engine, which is only made once they are all known
+	int engineNum = 0;
+	bool verbose = false;
+	bool reportEachTime = false;
+	bool doBB = false;
+	int bound = MUSbuilder::BOUND_DUAL;
+	int topK = 0;
+	int maxSize = -1;
+	bool sizeOrder = false;
+	int branching = MUSbuilder::BRANCH_STATIC;
+	size_t maxVisitedBytes = 0;
+	int numThreads = 1;
+	size_t memoBytes = 0;
+
 	// command line parameters
 	prog_name = argv[0];
 	while(1) {
 		// next option
-		int c = getopt(argc, argv, "vsbTt:");
+		int c = getopt(argc, argv, "vsE:bB:k:u:oH:TSm:j:D:t:");
 		if (c == -1) break;
 
 		// handle option
 		switch (c) {
-			case 'v': builder.setVerbose(true); cout << "CAMUS MUS version " << CAMUS_VERSION << endl; break;
+			case 'v': verbose = true; cout << "CAMUS MUS version " << CAMUS_VERSION << endl; break;
 			case 's': reportTime = true; break;
-			case 'b': builder.setDoBB(true); break;
-			case 'T': builder.setReportEachTime(true); break;
+			case 'E': engineNum = atoi(optarg); break;
+			case 'b': doBB = true; break;
+			case 'B':
+				bound = atoi(optarg);
+				if (bound < MUSbuilder::BOUND_DISJOINT || bound > MUSbuilder::BOUND_DUAL)  pusage();
+				break;
+			case 'k': topK = atoi(optarg); break;
+			case 'u': maxSize = atoi(optarg); break;
+			case 'o': sizeOrder = true; break;
+			case 'H':
+				branching = atoi(optarg);
+				if (branching < MUSbuilder::BRANCH_STATIC || branching > MUSbuilder::BRANCH_SMALLEST_COVER)  pusage();
+				break;
+			case 'T': reportEachTime = true; break;
+			case 'S': reportStats = true; break;
+			case 'm': maxVisitedBytes = (size_t)atoi(optarg) << 20; break;
+			case 'j': {
+				numThreads = atoi(optarg);
+				if (numThreads < 1)  numThreads = sysconf(_SC_NPROCESSORS_ONLN);
+				if (numThreads < 1)  numThreads = 1;
+				break;
+			}
+			case 'D': memoBytes = (size_t)atoi(optarg) << 20; break;
 			case 't': signal(SIGALRM, alarm_handler); alarm(atoi(optarg)); break;
 			default:
 				pusage();
 		}
 	}
+
+	HSEngine* builder = NULL;
+	if (engineNum == 1) {
+		if (doBB || bound != MUSbuilder::BOUND_DUAL || topK > 0 || maxSize >= 0 || sizeOrder
+				|| branching != MUSbuilder::BRANCH_STATIC || maxVisitedBytes > 0 || numThreads > 1 || memoBytes > 0) {
+			fprintf(stderr, "%s: -b, -B, -k, -u, -o, -H, -m, -j, and -D are not supported by -E 1\n", prog_name);
+			exit(1);
+		}
+		builder = new MMCSbuilder;
+	}
+	else if (engineNum == 0) {
+		if (memoBytes > 0 && (doBB || topK > 0 || maxSize >= 0 || sizeOrder || numThreads > 1)) {
+			fprintf(stderr, "%s: -D cannot be used with -b, -k, -u, -o, or -j\n", prog_name);
+			exit(1);
+		}
+		MUSbuilder* musBuilder = new MUSbuilder;
+		musBuilder->setDoBB(doBB);
+		musBuilder->setBound(bound);
+		musBuilder->setTopK(topK);
+		musBuilder->setMaxSize(maxSize);
+		musBuilder->setSizeOrder(sizeOrder);
+		musBuilder->setBranching(branching);
+		if (maxVisitedBytes > 0)  musBuilder->setMaxVisitedBytes(maxVisitedBytes);
+		musBuilder->setNumThreads(numThreads);
+		if (memoBytes > 0)  musBuilder->setMemoBytes(memoBytes);
+		builder = musBuilder;
+	}
+	else {
+		pusage();
+	}
+	builder->setVerbose(verbose);
+	builder->setReportEachTime(reportEachTime);
+	theBuilder = builder;
 	
 
 	list<Cover> MUSCovers;
@@ -114,7 +219,7 @@ int main(int argc, char** argv) {
 		coversIn.close();
 	}
 
-	builder.addSingletons(singletons);
+	builder->addSingletons(singletons);
 
 
 	ClauseMap clauseMapping;
@@ -123,7 +228,7 @@ int main(int argc, char** argv) {
 	MUSbuilder::generateMappingSorted(MUSCovers, clauseMapping, clauseMappingRev);
 	//MUSbuilder::generateMappingStraight(MUSCovers, clauseMapping, clauseMappingRev);
 
-	builder.addClauseMapping(clauseMappingRev);
+	builder->addClauseMapping(clauseMappingRev);
 
 	MUSbuilder::translateClauses(MUSCovers, clauseMapping);
 
@@ -132,11 +237,21 @@ int main(int argc, char** argv) {
 	clauseAssignment.resize(clauseMapping.size(), 0);
 
 	// Main function
-	builder.constructMUS(MUSCovers, clauseAssignment);
+	builder->constructMUS(MUSCovers, clauseAssignment);
 
 
+	fflush(stdout);
+	if (builder->wasInterrupted()) {
+		cerr << "Timeout reached." << endl;
+		if (reportStats)  builder->printStats(stderr);
+		exit(1);
+	}
+	if (reportStats) {
+		builder->printStats(stderr);
+	}
 	if (reportTime) {cerr << setprecision(3) << CPUTIME - cpu_time << endl;}
 
+	delete builder;
 	return 0;
 }
 
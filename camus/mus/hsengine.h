@@ -0,0 +1,127 @@
+/*
+ *  hsengine.h  -  The interface shared by the algorithms camus_mus can use
+ *  to construct MUSes from MCSes (minimal hitting sets of the MCSes)
+ *
+ * Copyright (C) 2009, The Regents of the University of Michigan
+ * See the LICENSE file for details.
+ *
+ */
+
+#ifndef HSENGINE_H
+#define HSENGINE_H
+
+#include <list>
+#include <set>
+
+#include <hash_map>
+
+#include <vector>
+#include <string>
+#include <sstream>
+#include <time.h>
+#include <stdio.h>
+
+using namespace::std;
+
+#define foreach(x,y,z)  for (x::iterator (y) = (z).begin() ; (y) != (z).end() ; (y)++)
+
+typedef unsigned int Num;
+typedef std::set<Num>  Cover;
+
+#ifdef USING_STLPORT
+typedef hash_map<Num,int> ClauseMap;
+#else
+typedef __gnu_cxx::hash_map<Num,int> ClauseMap;
+#endif
+
+//typedef vector<char>  ClauseAssign;
+class ClauseAssign : public vector<char> {
+public:
+	int numPos, numNeg;
+	ClauseAssign() : numPos(0), numNeg(0) {}
+};
+
+// An algorithm for constructing MUSes from covers whose clauses have been
+// compressed to 0..n-1 (see MUSbuilder::generateMapping*()).  The singletons
+// and the clause mapping given to it are used for output, which is the same
+// for every engine: one line per MUS, in original clause numbers.
+class HSEngine {
+protected:
+	bool verbose;
+	bool reportEachTime;
+
+	// Singleton MCSes are clauses that will be contained in every MUS;
+	// therefore, we need not involve them in any computations.  We store
+	// them in a vector and create a string *once*, to print at the beginning
+	// of every output MUS, containing the clauses indicated by singleton MCSes.
+	vector<Num> singletons;
+	string singletonsStr;
+
+	ClauseMap clauseMappingRev;	// new to original numbers
+
+	inline int mapToOrig(Num clause) {
+		return clauseMappingRev[clause];
+	}
+
+	// Start a line of output for an MUS in out (with its timestamp, if
+	// reportEachTime, and the singletons); the caller appends its clauses
+	// with appendClause() and ends the line.
+	inline void startMUS(string& out) {
+		if (reportEachTime) {
+			char num[32];
+			snprintf(num, sizeof(num), "%lld: ", (long long)(time(NULL)));
+			out += num;
+		}
+		out += singletonsStr;
+	}
+	inline void appendClause(string& out, Num clause) {
+		char num[32];
+		snprintf(num, sizeof(num), "%d ", mapToOrig(clause));
+		out += num;
+	}
+
+public:
+	HSEngine() :
+		verbose(false),
+		reportEachTime(false),
+		singletonsStr("")
+	{ }
+	virtual ~HSEngine() { }
+
+	void setVerbose(bool b)			{ verbose = b; }
+	void setReportEachTime(bool b)	{ reportEachTime = b; }
+
+	// Add a clause mapping (from new clause IDs to original clause indexes)
+	void addClauseMapping(ClauseMap& newClauseMappingRev) {
+		clauseMappingRev = newClauseMappingRev;
+	}
+
+	// Pass singletons into this object
+	// Creates the string used to output them (to be reused instead of
+	// recreated each time it's needed).
+	void addSingletons(vector<Num>& newSingletons) {
+		if (newSingletons.empty()) {return;}
+		singletons = newSingletons;
+		// make a string of it, too -- to save time when outputting
+		ostringstream o;
+		foreach(vector<Num>, it, singletons) {
+			o << *it << " ";
+		}
+		singletonsStr = o.str();
+	}
+
+	// Construct all MUSes from the given covers, starting from the given
+	// (partial) assignment
+	virtual bool constructMUS(const list<Cover>& MUSCovers, const ClauseAssign& assign) = 0;
+
+	// Stop the search early (from a signal handler).  Returns false if the
+	// engine cannot, and otherwise constructMUS() returns soon after with
+	// wasInterrupted() true.
+	virtual bool interrupt() { return false; }
+	virtual bool wasInterrupted() { return false; }
+
+	// Report statistics of the search (for -S)
+	virtual void printStats(FILE* out) = 0;
+};
+
+#endif
@@ -0,0 +1,148 @@
+/*
+ *  memo.h  -  A memory-bounded cache of the results of MUSbuilder's search
+ *  subproblems, shared as a DAG
+ *
+ * Copyright (C) 2009, The Regents of the University of Michigan
+ * See the LICENSE file for details.
+ *
+ */
+
+#ifndef MEMO_H
+#define MEMO_H
+
+#include <vector>
+#include <deque>
+#include <utility>
+#include <hash_map>
+
+#include "visited.h"
+
+// The result of searching one subproblem (a set of remaining covers): every
+// way the search completed the MUS under construction from there.  Those are
+// the clauses propagated at the node (forced), followed by either nothing (no
+// covers were left: the node is an MUS), or, for each child, the clause it
+// added and the child's own result.  Results are shared by every node that
+// reaches them, so they form a DAG, and are freed once nothing refers to them.
+// A result is incomplete if part of the search below it was not recorded
+// (for lack of memory); it then has no children and is never reused.
+// Whoever create()s a result holds a reference to it, to release() when done.
+struct MemoEntry {
+	std::vector<unsigned int> forced;
+	std::vector< std::pair<unsigned int, MemoEntry*> > children;
+	bool isMUS;
+	bool complete;
+	int refs;
+
+	MemoEntry(bool complete) : isMUS(false), complete(complete), refs(1) {}
+};
+
+struct FingerprintHash {
+	inline size_t operator()(const Fingerprint& fp) const { return fp.lo; }
+};
+
+// The cached results, by a fingerprint of their subproblem.  Its memory use
+// counts every result still alive, cached or not (see MemoEntry).  Past the
+// limit, the oldest cached results are dropped, and if that is not enough,
+// new results are made incomplete.
+class MemoTable {
+private:
+#ifdef USING_STLPORT
+	typedef hash_map<Fingerprint, MemoEntry*, FingerprintHash> Index;
+#else
+	typedef __gnu_cxx::hash_map<Fingerprint, MemoEntry*, FingerprintHash> Index;
+#endif
+	Index index;
+	std::deque<Fingerprint> order;		// cached keys, oldest first
+	size_t maxBytes;
+	size_t bytes;
+
+	static const size_t ENTRY_BYTES = sizeof(MemoEntry) + 2 * sizeof(Fingerprint);
+
+public:
+	unsigned long long lookups;
+	unsigned long long hits;
+	unsigned long long replayed;	// MUSes output from cached results
+	unsigned long long evicted;
+	unsigned long long incomplete;
+
+	MemoTable(size_t maxBytes) : maxBytes(maxBytes), bytes(0), lookups(0), hits(0), replayed(0), evicted(0), incomplete(0) {}
+	~MemoTable() {
+		for (Index::iterator it = index.begin() ; it != index.end() ; it++)  release(it->second);
+	}
+
+	MemoEntry* find(const Fingerprint& key) {
+		lookups++;
+		Index::iterator it = index.find(key);
+		if (it == index.end())  return NULL;
+		hits++;
+		return it->second;
+	}
+
+	// A new result, complete if there is memory for it
+	MemoEntry* create() {
+		while (bytes > maxBytes && !order.empty())  evictOldest();
+		bool room = (bytes <= maxBytes);
+		if (!room)  incomplete++;
+		bytes += sizeof(MemoEntry);
+		return new MemoEntry(room);
+	}
+
+	void addForced(MemoEntry* e, unsigned int clause) {
+		if (!e->complete)  return;
+		e->forced.push_back(clause);
+		bytes += sizeof(unsigned int);
+	}
+
+	// Add a child's result to a result, which becomes incomplete with it
+	void addChild(MemoEntry* e, unsigned int clause, MemoEntry* child) {
+		if (!e->complete)  return;
+		if (!child->complete) {
+			makeIncomplete(e);
+			return;
+		}
+		e->children.push_back(std::make_pair(clause, child));
+		child->refs++;
+		bytes += sizeof(std::pair<unsigned int, MemoEntry*>);
+	}
+
+	void makeIncomplete(MemoEntry* e) {
+		for (unsigned int i = 0 ; i < e->children.size() ; i++)  release(e->children[i].second);
+		bytes -= e->children.size() * sizeof(std::pair<unsigned int, MemoEntry*>);
+		std::vector< std::pair<unsigned int, MemoEntry*> >().swap(e->children);
+		e->complete = false;
+	}
+
+	// Cache a (complete) result
+	void insert(const Fingerprint& key, MemoEntry* e) {
+		if (!e->complete || index.find(key) != index.end())  return;
+		index[key] = e;
+		e->refs++;
+		order.push_back(key);
+		bytes += ENTRY_BYTES;
+	}
+
+	// Drop a reference to a result, freeing it (and so on down) if it was
+	// the last
+	void release(MemoEntry* e) {
+		if (--e->refs > 0)  return;
+		for (unsigned int i = 0 ; i < e->children.size() ; i++)  release(e->children[i].second);
+		bytes -= sizeof(MemoEntry) + e->forced.size() * sizeof(unsigned int)
+			+ e->children.size() * sizeof(std::pair<unsigned int, MemoEntry*>);
+		delete e;
+	}
+
+	void evictOldest() {
+		Index::iterator it = index.find(order.front());
+		order.pop_front();
+		bytes -= ENTRY_BYTES;
+		evicted++;
+		MemoEntry* e = it->second;
+		index.erase(it);
+		release(e);
+	}
+
+	size_t size() const { return index.size(); }
+	size_t getBytes() const { return bytes; }
+};
+
+#endif
@@ -0,0 +1,161 @@
+/*
+ *  visited.h  -  A bounded hash set of 128-bit fingerprints of search states,
+ *  used by MUSbuilder to detect nodes it has already visited
+ *
+ * Copyright (C) 2009, The Regents of the University of Michigan
+ * See the LICENSE file for details.
+ *
+ */
+
+#ifndef VISITED_H
+#define VISITED_H
+
+#include <vector>
+#include <cstddef>
+#include <pthread.h>
+
+#include "bitcover.h"
+
+struct Fingerprint {
+	Word lo, hi;
+
+	inline bool operator==(const Fingerprint& other) const {
+		return lo == other.lo && hi == other.hi;
+	}
+	inline void operator^=(const Fingerprint& other) {
+		lo ^= other.lo;
+		hi ^= other.hi;
+	}
+};
+
+// Open addressing (linear probing) over a power-of-two number of slots,
+// doubled whenever it is 3/4 full.  With a memory limit, a table that can no
+// longer grow stops storing new fingerprints, but still finds the ones it
+// has, so its user just loses some pruning.  The all-zero fingerprint marks
+// an empty slot, so it is stored as a (different) nonzero one.
+class VisitedTable {
+private:
+	std::vector<Fingerprint> slots;
+	size_t count;
+	size_t maxBytes;	// 0 = no limit
+	bool full;
+
+	unsigned long long lookups;
+	unsigned long long hits;
+
+	static const size_t INITIAL_SLOTS = 1 << 16;
+
+	inline size_t find(const Fingerprint& fp) const {
+		size_t mask = slots.size() - 1;
+		size_t i = fp.lo & mask;
+		while ((slots[i].lo | slots[i].hi) != 0 && !(slots[i] == fp)) {
+			i = (i+1) & mask;
+		}
+		return i;
+	}
+
+	bool grow() {
+		if (maxBytes != 0 && 2 * slots.size() * sizeof(Fingerprint) > maxBytes)  return false;
+
+		std::vector<Fingerprint> old(2 * slots.size());
+		old.swap(slots);
+		for (std::vector<Fingerprint>::iterator it = old.begin() ; it != old.end() ; it++) {
+			if ((it->lo | it->hi) != 0)  slots[find(*it)] = *it;
+		}
+		return true;
+	}
+
+public:
+	VisitedTable(size_t initialSlots = INITIAL_SLOTS) : count(0), maxBytes(0), full(false), lookups(0), hits(0) {
+		slots.resize(initialSlots);
+	}
+
+	// Limit the table (while still empty) to (about) the given number of bytes
+	void setMaxBytes(size_t bytes) {
+		maxBytes = bytes;
+		size_t n = slots.size();
+		while (n > 16 && n * sizeof(Fingerprint) > maxBytes)  n /= 2;
+		slots.assign(n, Fingerprint());
+	}
+
+	// Add a fingerprint (if there is room), returning true if it was
+	// already there
+	inline bool insert(Fingerprint fp) {
+		if ((fp.lo | fp.hi) == 0)  fp.lo = 1;
+		lookups++;
+
+		size_t i = find(fp);
+		if (slots[i] == fp) {
+			hits++;
+			return true;
+		}
+		if (full)  return false;
+
+		if (4 * (count+1) > 3 * slots.size()) {
+			if (!grow()) {
+				full = true;
+				return false;
+			}
+			i = find(fp);
+		}
+		slots[i] = fp;
+		count++;
+		return false;
+	}
+
+	// Forget every fingerprint (keeping the statistics)
+	void clear() {
+		slots.assign(slots.size(), Fingerprint());
+		count = 0;
+		full = false;
+	}
+
+	size_t size() const { return count; }
+	size_t bytes() const { return slots.size() * sizeof(Fingerprint); }
+	bool isFull() const { return full; }
+	unsigned long long getLookups() const { return lookups; }
+	unsigned long long getHits() const { return hits; }
+};
+
+// A VisitedTable shared by several threads: split into shards (by the high
+// bits of the fingerprints), each with its own lock.
+class SharedVisitedTable {
+private:
+	static const int SHARD_BITS = 6;
+	static const int SHARDS = 1 << SHARD_BITS;
+	std::vector<VisitedTable> shards;
+	pthread_mutex_t locks[SHARDS];
+
+public:
+	SharedVisitedTable() : shards(SHARDS, VisitedTable(1 << 10)) {
+		for (int i = 0 ; i < SHARDS ; i++)  pthread_mutex_init(&locks[i], NULL);
+	}
+	~SharedVisitedTable() {
+		for (int i = 0 ; i < SHARDS ; i++)  pthread_mutex_destroy(&locks[i]);
+	}
+
+	void setMaxBytes(size_t bytes) {
+		for (int i = 0 ; i < SHARDS ; i++)  shards[i].setMaxBytes(bytes / SHARDS);
+	}
+
+	inline bool insert(const Fingerprint& fp) {
+		int i = fp.hi >> (64 - SHARD_BITS);
+		pthread_mutex_lock(&locks[i]);
+		bool found = shards[i].insert(fp);
+		pthread_mutex_unlock(&locks[i]);
+		return found;
+	}
+
+	void clear() {
+		for (int i = 0 ; i < SHARDS ; i++)  shards[i].clear();
+	}
+
+	// (statistics are only meaningful once no thread is inserting)
+	size_t size() const { size_t n = 0; for (int i = 0 ; i < SHARDS ; i++) n += shards[i].size(); return n; }
+	size_t bytes() const { size_t n = 0; for (int i = 0 ; i < SHARDS ; i++) n += shards[i].bytes(); return n; }
+	bool isFull() const { for (int i = 0 ; i < SHARDS ; i++) if (shards[i].isFull()) return true; return false; }
+	unsigned long long getLookups() const { unsigned long long n = 0; for (int i = 0 ; i < SHARDS ; i++) n += shards[i].getLookups(); return n; }
+	unsigned long long getHits() const { unsigned long long n = 0; for (int i = 0 ; i < SHARDS ; i++) n += shards[i].getHits(); return n; }
+};
+
+#endif